@@ -0,0 +1,35 @@
+#pragma once
+// Bounding volume hierarchy, built once from a hittable list
+
+#include <cstddef>
+#include <vector>
+
+#include "hittables/hittable.h"
+#include "hittables/hittable_list.h"
+#include "utils/aabb.h"
+#include "utils/arena.h"
+
+class bvh_node : public hittable {
+  // Children, in the arena of the scene, right is null in a single-object
+  // leaf and both are null for an empty world
+  const hittable *left = nullptr;
+  const hittable *right = nullptr;
+  // Bounding box enclosing both children
+  aabb bbox;
+  // Axis the children were split along, decides which child is visited first
+  int split_axis;
+
+public:
+  // Build the hierarchy from all objects of the list, creating the inner nodes
+  // and sphere soups in nodes, depth first so subtrees lie together
+  bvh_node(arena &nodes, hittable_list list);
+  // Build the hierarchy from objects[start, end), reordering them
+  bvh_node(arena &nodes, std::vector<hittable *> &objects, size_t start,
+           size_t end);
+
+  // Determine if the ray hits any object in the hierarchy, nearest first
+  bool hit(const ray &r, interval ray_t, hit_record &record) const override;
+  // Determine if the ray hits any object in the hierarchy, in any order
+  bool occluded(const ray &r, interval ray_t) const override;
+  aabb bounding_box() const override;
+};
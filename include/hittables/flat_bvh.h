@@ -0,0 +1,96 @@
+#pragma once
+// Flat bounding volume hierarchy over primitives stored by the owner in one
+// array: the nodes live in one vector and index ranges of that array, so the
+// owner tests its primitives directly instead of through hittable
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils/aabb.h"
+#include "utils/counters.h"
+#include "utils/interval.h"
+#include "utils/ray.h"
+
+class flat_bvh {
+  // Node of the hierarchy, the first child of an inner node directly follows
+  // it
+  struct entry {
+    aabb box;
+    // First primitive of a leaf, or the second child of an inner node
+    uint32_t offset;
+    // Primitives of a leaf, 0 for inner nodes
+    uint16_t count;
+    // Axis the children were split along, decides which is visited first
+    uint16_t axis;
+  };
+
+  // nodes[0] is the root
+  std::vector<entry> nodes;
+
+  // Depth from which nodes are split in the middle instead, so even
+  // 2^32 primitives stay within the fixed traversal stack
+  static constexpr int max_sah_depth = 24;
+
+  // Build the subtree over order[start, end) at depth, returns its node index
+  uint32_t build(std::vector<uint32_t> &order, const std::vector<aabb> &boxes,
+                 size_t max_leaf_size, size_t start, size_t end, int depth);
+
+public:
+  // Build the hierarchy over the boxes of the primitives, with at most
+  // max_leaf_size primitives per leaf
+  // Returns the order of the primitives: the owner must store primitive
+  // order[k] at index k, so every leaf covers a contiguous range
+  std::vector<uint32_t> build(const std::vector<aabb> &boxes,
+                              size_t max_leaf_size);
+
+  bool empty() const { return nodes.empty(); }
+
+  // Box of all primitives
+  aabb bounding_box() const { return nodes.empty() ? aabb() : nodes[0].box; }
+
+  // Call test(first, count, ray_t) for every leaf whose box the ray hits
+  // within ray_t, nearer child first; test checks the primitives
+  // [first, first + count) and counts its object tests, may shrink ray_t to a
+  // hit found, and returns true to stop the traversal
+  template <class leaf_test>
+  void traverse(const ray &r, interval &ray_t, leaf_test &&test) const;
+};
+
+template <class leaf_test>
+void flat_bvh::traverse(const ray &r, interval &ray_t,
+                        leaf_test &&test) const {
+  if (nodes.empty()) {
+    return;
+  }
+
+  // Depth-first traversal
+  // NOTE: median splits below max_sah_depth keep the depth below 64
+  uint32_t stack[64];
+  int stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    const entry &node = nodes[stack[--stack_size]];
+    count_bvh_node();
+    if (!node.box.hit(r, ray_t)) {
+      continue;
+    }
+
+    if (node.count > 0) {
+      if (test(size_t(node.offset), size_t(node.count), ray_t)) {
+        return;
+      }
+      continue;
+    }
+
+    // Push the farther child first so the nearer one is visited first
+    const uint32_t first_child = uint32_t(&node - nodes.data()) + 1;
+    if (r.direction()[node.axis] < 0) {
+      stack[stack_size++] = first_child;
+      stack[stack_size++] = node.offset;
+    } else {
+      stack[stack_size++] = node.offset;
+      stack[stack_size++] = first_child;
+    }
+  }
+}
@@ -1,8 +1,7 @@
 #pragma once
 // Hittable objects are objects that can be hit by rays
 
-#include <memory>
-
+#include "utils/aabb.h"
 #include "utils/interval.h"
 #include "utils/ray.h"
 #include "utils/vec3.h"
@@ -12,19 +11,38 @@ class material;
 struct hit_record {
   point3 point;
   vec3 normal;
-  std::shared_ptr<material> mat;
-  double t;
+  // Material of the object hit, owned by the scene
+  const material *mat = nullptr;
+  real t = 0;
   bool front_face;
 
-  hit_record();
-
   // Set front_face and normal based on the ray direction
   // NOTE: outward_normal is assumed to be a unit vector
-  void set_face_normal(const ray &r, const vec3 &outward_normal);
+  void set_face_normal(const ray &r, const vec3 &outward_normal) {
+    // Dot product of the ray direction and the outward normal
+    // positive: negate the normal
+    // negative: keep the normal
+    // If the dot product is negative, the ray is outside the object, set
+    // front_face to true
+    front_face = dot(r.direction(), outward_normal) < 0;
+    normal = front_face ? outward_normal : -outward_normal;
+  }
 };
 
 class hittable {
 public:
+  // Determine if the ray hits the object within ray_t
+  // NOTE: record is only written when the object is hit
   virtual bool hit(const ray &r, interval ray_t, hit_record &record) const = 0;
-  virtual ~hittable() = default;
+  // Determine if the ray hits anything within ray_t, stopping at the first
+  // hit found, without computing normals or touching materials
+  virtual bool occluded(const ray &r, interval ray_t) const = 0;
+  // Bounding box enclosing the whole object, used to build the BVH
+  virtual aabb bounding_box() const = 0;
+
+protected:
+  // Hittables live in the scene arena and are never destroyed through a
+  // hittable pointer; a trivial destructor lets the arena skip the ones that
+  // own no memory
+  ~hittable() = default;
 };
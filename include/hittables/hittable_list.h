@@ -1,23 +1,26 @@
 #pragma once
 // A list of hittable objects (Partly world)
 
-#include <memory>
 #include <vector>
 
 #include "hittables/hittable.h"
 
 class hittable_list : public hittable {
 public:
-  // List of pointers to hittable objects
-  std::vector<std::shared_ptr<hittable>> objects;
+  // List of hittable objects, owned by the scene arena
+  std::vector<hittable *> objects;
+  // Bounding box enclosing all objects in the list
+  aabb bbox;
 
   hittable_list() = default;
-  hittable_list(std::shared_ptr<hittable> object);
+  hittable_list(hittable *object);
 
   // Clear list
   void clear();
   // Add an object to the list
-  void add(std::shared_ptr<hittable> object);
+  void add(hittable *object);
 
   bool hit(const ray &r, interval ray_t, hit_record &record) const override;
-};
\ No newline at end of file
+  bool occluded(const ray &r, interval ray_t) const override;
+  aabb bounding_box() const override;
+};
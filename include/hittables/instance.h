@@ -0,0 +1,24 @@
+#pragma once
+// Instance: a shared object placed in the world by an affine transform, so
+// repeated geometry is stored and its BVH built only once
+
+#include "hittables/hittable.h"
+#include "utils/transform.h"
+
+class instance : public hittable {
+  // Object in its own space, owned by the scene and shared by any number of
+  // instances
+  const hittable *object;
+  affine_transform object_to_world, world_to_object;
+  // Box enclosing the transformed box of the object
+  aabb bbox;
+
+public:
+  instance(const hittable *object, const affine_transform &object_to_world);
+
+  // Determine if the ray hits the object, transforming the ray into object
+  // space and the hit back into world space
+  bool hit(const ray &r, interval ray_t, hit_record &record) const override;
+  bool occluded(const ray &r, interval ray_t) const override;
+  aabb bounding_box() const override;
+};
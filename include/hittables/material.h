@@ -1,19 +1,25 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+
 #include "hittables/hittable.h"
 #include "utils/color.h"
 
-// Abstract base class for materials
-class material {
-public:
-  virtual bool scatter(const ray &r_in, const hit_record &rec,
-                       color &attenuation, ray &scattered) const;
-
-  virtual ~material();
+// Concrete materials, in the order of the alternatives of material; also the
+// material type stored in the scene cache, scatter calls are counted per kind
+// and the wavefront integrator bins hits by kind
+enum class material_kind : uint32_t {
+  lambertian,
+  metal,
+  dielectric,
+  light,
+  count
 };
 
 // Lambertian material
-class lambertian : public material {
+class lambertian {
   color albedo;
 
 public:
@@ -22,37 +28,95 @@ public:
 
   // Scatter function
   bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
-               ray &scattered) const override;
+               ray &scattered) const;
+
+  // Cosine-weighted scattering, albedo * cos / pi
+  color bsdf_cosine(const hit_record &rec, const vec3 &direction) const;
+  real scattering_pdf(const hit_record &rec, const vec3 &direction) const;
 };
 
 // Metal material
-class metal : public material {
+class metal {
   color albedo;
-  double fuzz;
+  real fuzz;
 
 public:
   // Constructor, using color as albedo, and fuzziness
-  metal(const color &albedo, const double fuzz);
+  metal(const color &albedo, const real fuzz);
 
   // Scatter function
   bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
-               ray &scattered) const override;
+               ray &scattered) const;
 };
 
 // Dielectric material
-class dielectric : public material {
+class dielectric {
   // Refractive index in vacuum or air, or the ratio of the material's
   // refractive index over the refractive index of the enclosing media
-  double refractive_index;
+  real refractive_index;
 
   // Schlick approximation for reflectance
-  static double reflectance(double cosine, double refraction_index);
+  static real reflectance(real cosine, real refraction_index);
 
 public:
   // Constructor, using refractive index
-  dielectric(double refractive_index);
+  dielectric(real refractive_index);
 
   // Scatter function
   bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
-               ray &scattered) const override;
+               ray &scattered) const;
+};
+
+// Diffuse light, emitting radiance from the front face and absorbing any
+// incoming ray
+class diffuse_light {
+  color emission;
+
+public:
+  // Constructor, using the emitted radiance, which may exceed 1
+  diffuse_light(const color &emission);
+
+  color emitted(const hit_record &rec) const;
+};
+
+// Material of a surface: one of the materials above held by value, tagged by
+// its material_kind, so the scene keeps all materials in one table and every
+// call dispatches by a switch on the kind instead of through a vtable
+class material {
+  // Alternatives in the order of material_kind
+  std::variant<lambertian, metal, dielectric, diffuse_light> value;
+  static_assert(std::variant_size_v<decltype(value)> ==
+                    size_t(material_kind::count),
+                "one alternative per material_kind");
+
+public:
+  // Constructors, from any of the materials above
+  material(const lambertian &m);
+  material(const metal &m);
+  material(const dielectric &m);
+  material(const diffuse_light &m);
+
+  // Concrete type of the material
+  material_kind kind() const {
+    return static_cast<material_kind>(value.index());
+  }
+
+  // Scatter the incoming ray, false if it is absorbed
+  bool scatter(const ray &r_in, const hit_record &rec, color &attenuation,
+               ray &scattered) const;
+
+  // Radiance emitted at the hit towards the incoming ray, black unless a light
+  color emitted(const hit_record &rec) const;
+
+  // Whether scatter only picks from a few directions (mirror, refraction, or
+  // none at all), sampling the lights directly then never helps
+  bool is_specular() const;
+
+  // BSDF times the cosine to the normal for light leaving the hit towards the
+  // unit direction, black for specular materials
+  color bsdf_cosine(const hit_record &rec, const vec3 &direction) const;
+
+  // Solid angle density of scatter choosing the unit direction, 0 for
+  // specular materials
+  real scattering_pdf(const hit_record &rec, const vec3 &direction) const;
 };
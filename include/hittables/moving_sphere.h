@@ -0,0 +1,27 @@
+#pragma once
+// Sphere moving linearly from one center at time 0 to another at time 1
+
+#include "hittables/hittable.h"
+
+class moving_sphere : public hittable {
+  point3 center0;
+  // Displacement of the center from time 0 to time 1
+  vec3 motion;
+  real radius;
+  // Material, owned by the scene
+  const material *mat;
+  // Box swept by the sphere from time 0 to time 1
+  aabb bbox;
+
+public:
+  moving_sphere(const point3 &center0, const point3 &center1,
+                const real radius, const material *mat);
+
+  // Center at time, the sphere moves with constant velocity
+  point3 center_at(real time) const { return center0 + time * motion; }
+
+  // Determine if the ray hits the sphere at the time of the ray
+  bool hit(const ray &r, interval ray_t, hit_record &record) const override;
+  bool occluded(const ray &r, interval ray_t) const override;
+  aabb bounding_box() const override;
+};
@@ -0,0 +1,128 @@
+#pragma once
+// Bounding volume hierarchy over primitives of one concrete type, stored by
+// value in one array, so neither the traversal nor the primitive tests make a
+// virtual call
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "hittables/flat_bvh.h"
+#include "hittables/hittable.h"
+#include "hittables/hittable_list.h"
+#include "utils/arena.h"
+
+// NOTE: primitive must be final, so calls through it are direct
+template <class primitive> class primitive_bvh : public hittable {
+  static_assert(std::is_base_of_v<hittable, primitive> &&
+                    std::is_final_v<primitive>,
+                "primitive must be a final hittable");
+
+  // Primitives, owned by the scene and reordered in place so every leaf
+  // covers a contiguous range
+  primitive *primitives;
+  size_t primitive_count;
+  // Hierarchy over the primitives
+  flat_bvh bvh;
+
+  // Primitives per leaf the build stops splitting at
+  // NOTE: for spheres, these inlined tests one by one are no slower than
+  // sphere_soup SIMD leaves of 8, which go through the kernel chosen at
+  // runtime, so sphere-only scenes keep them
+  static constexpr size_t max_leaf_size = 4;
+
+public:
+  // Build the hierarchy over primitives[0, count), reordering them in place
+  primitive_bvh(primitive *primitives, size_t count);
+
+  size_t size() const { return primitive_count; }
+
+  // Determine the nearest primitive hit by the ray
+  bool hit(const ray &r, interval ray_t, hit_record &record) const override;
+  // Determine if the ray hits any primitive, stopping at the first
+  bool occluded(const ray &r, interval ray_t) const override;
+  aabb bounding_box() const override { return bvh.bounding_box(); }
+};
+
+// Create a primitive_bvh in memory over the objects of the list if they are
+// exactly primitives stored one after another in list order, as the scene
+// creates them, nullptr otherwise
+// NOTE: the primitives are reordered in place, so the pointers of the list no
+// longer refer to the same objects afterwards
+template <class primitive>
+primitive_bvh<primitive> *make_primitive_bvh(arena &memory,
+                                             const hittable_list &list) {
+  primitive *first = nullptr;
+  for (size_t k = 0; k < list.objects.size(); k++) {
+    const auto p = dynamic_cast<primitive *>(list.objects[k]);
+    if (p == nullptr || (k > 0 && p != first + k)) {
+      return nullptr;
+    }
+    first = k == 0 ? p : first;
+  }
+  return memory.create<primitive_bvh<primitive>>(first, list.objects.size());
+}
+
+// Build the hierarchy over primitives[0, count), reordering them in place
+template <class primitive>
+primitive_bvh<primitive>::primitive_bvh(primitive *primitives, size_t count)
+    : primitives(primitives), primitive_count(count) {
+  std::vector<aabb> boxes;
+  boxes.reserve(count);
+  for (size_t k = 0; k < count; k++) {
+    boxes.push_back(primitives[k].bounding_box());
+  }
+
+  // Move primitive order[k] to index k, one cycle of the permutation at a
+  // time, so no second copy of the primitives is made
+  const std::vector<uint32_t> order = bvh.build(boxes, max_leaf_size);
+  std::vector<bool> placed(count, false);
+  for (size_t start = 0; start < count; start++) {
+    if (placed[start]) {
+      continue;
+    }
+    const primitive first = primitives[start];
+    size_t k = start;
+    while (order[k] != start) {
+      primitives[k] = primitives[order[k]];
+      placed[k] = true;
+      k = order[k];
+    }
+    primitives[k] = first;
+    placed[k] = true;
+  }
+}
+
+// Determine the nearest primitive hit by the ray
+template <class primitive>
+bool primitive_bvh<primitive>::hit(const ray &r, interval ray_t,
+                                   hit_record &record) const {
+  bool hit_anything = false;
+  bvh.traverse(r, ray_t, [&](size_t first, size_t count, interval &range) {
+    for (size_t k = first; k < first + count; k++) {
+      if (primitives[k].hit(r, range, record)) {
+        range.max = record.t;
+        hit_anything = true;
+      }
+    }
+    return false;
+  });
+  return hit_anything;
+}
+
+// Determine if the ray hits any primitive, stopping at the first
+template <class primitive>
+bool primitive_bvh<primitive>::occluded(const ray &r, interval ray_t) const {
+  bool hit_anything = false;
+  bvh.traverse(r, ray_t, [&](size_t first, size_t count, interval &range) {
+    for (size_t k = first; k < first + count; k++) {
+      if (primitives[k].occluded(r, range)) {
+        hit_anything = true;
+        return true;
+      }
+    }
+    return false;
+  });
+  return hit_anything;
+}
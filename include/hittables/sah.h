@@ -0,0 +1,96 @@
+#pragma once
+// Binned surface area heuristic split shared by the BVH builders
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+#include "utils/aabb.h"
+#include "utils/interval.h"
+#include "utils/rtweekend.h"
+
+// Number of bins the surface area heuristic evaluates per axis
+constexpr int sah_bins = 16;
+
+// Find the split of the items [first, last) with the lowest surface area
+// heuristic cost and move the items of the left child to the front
+// box_of(item) gives the box of an item, centroid_box bounds their centroids
+// Returns the first item of the right child and sets axis to the split axis,
+// or returns first if no split separates the items
+template <class iterator, class box_getter>
+iterator sah_partition(iterator first, iterator last,
+                       const aabb &centroid_box, box_getter &&box_of,
+                       int &axis) {
+  // Items are binned by their centroid, cost of a split between bins is
+  // (left area * left count) + (right area * right count)
+  struct bin {
+    aabb box;
+    size_t count = 0;
+  };
+
+  double best_cost = infinity;
+  int best_axis = -1;
+  int best_bin = 0;
+
+  for (int a = 0; a < 3; a++) {
+    const interval &extent = centroid_box.axis_interval(a);
+    if (extent.size() <= 0) {
+      continue;
+    }
+
+    // Bin index of an item along this axis
+    const double scale = sah_bins / extent.size();
+    std::array<bin, sah_bins> bins;
+    for (iterator it = first; it != last; ++it) {
+      const aabb box = box_of(*it);
+      const double c = box.centroid()[a];
+      bin &b = bins[std::min(int((c - extent.min) * scale), sah_bins - 1)];
+      b.box = aabb(b.box, box);
+      b.count++;
+    }
+
+    // Sweep from the right, right_* [k] describes bins [k, sah_bins)
+    std::array<double, sah_bins> right_area{};
+    std::array<size_t, sah_bins> right_count{};
+    aabb accumulated;
+    size_t count = 0;
+    for (int k = sah_bins - 1; k > 0; k--) {
+      accumulated = aabb(accumulated, bins[k].box);
+      count += bins[k].count;
+      right_area[k] = count > 0 ? accumulated.surface_area() : 0.0;
+      right_count[k] = count;
+    }
+
+    // Sweep from the left, splitting between bin k and bin k + 1
+    accumulated = aabb();
+    count = 0;
+    for (int k = 0; k < sah_bins - 1; k++) {
+      accumulated = aabb(accumulated, bins[k].box);
+      count += bins[k].count;
+      if (count == 0 || right_count[k + 1] == 0) {
+        continue;
+      }
+      const double cost = count * accumulated.surface_area() +
+                          right_count[k + 1] * right_area[k + 1];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = a;
+        best_bin = k;
+      }
+    }
+  }
+
+  // No valid split found
+  if (best_axis < 0) {
+    return first;
+  }
+
+  // Move the items in bins [0, best_bin] to the front
+  axis = best_axis;
+  const interval &extent = centroid_box.axis_interval(best_axis);
+  const double scale = sah_bins / extent.size();
+  return std::partition(first, last, [&](const auto &item) {
+    const double c = box_of(item).centroid()[best_axis];
+    return std::min(int((c - extent.min) * scale), sah_bins - 1) <= best_bin;
+  });
+}
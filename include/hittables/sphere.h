@@ -1,20 +1,37 @@
 #pragma once
 // Sphere class derived from hittable
 
-#include <memory>
-
 #include "hittables/hittable.h"
 
-class sphere : public hittable {
+// Parameter t of the nearest hit of the ray on the sphere within ray_t
+// Returns false if there is none
+bool intersect_sphere(const point3 &center, real radius, const ray &r,
+                      interval ray_t, real &t);
+
+// Determine if the ray hits the sphere of center and radius, filling the
+// record with mat on a hit
+bool hit_sphere(const point3 &center, real radius, const material *mat,
+                const ray &r, interval ray_t, hit_record &record);
+
+// Final, so primitive_bvh<sphere> calls it directly
+class sphere final : public hittable {
   point3 center;
-  double radius;
-  std::shared_ptr<material> mat;
+  real radius;
+  // Material, owned by the scene
+  const material *mat;
+  aabb bbox;
+
+  // Sphere soups copy the sphere data into their own arrays
+  friend class sphere_soup;
 
 public:
-  sphere(const point3 &center, const double radius,
-         std::shared_ptr<material> mat);
+  // Empty sphere, for arrays of spheres filled in place
+  sphere() = default;
+  sphere(const point3 &center, const real radius,
+         const material *mat);
 
   // Determine if the ray hits the sphere
   bool hit(const ray &r, interval ray_t, hit_record &record) const override;
-  ~sphere() override = default;
+  bool occluded(const ray &r, interval ray_t) const override;
+  aabb bounding_box() const override;
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+// Many spheres stored as structure of arrays, intersected several at a time
+// with SIMD instructions chosen at runtime
+
+#include <array>
+#include <cstddef>
+
+#include "hittables/hittable.h"
+#include "hittables/sphere.h"
+
+class sphere_soup : public hittable {
+public:
+  // Maximum number of spheres of a soup, the BVH groups up to this many into
+  // one sphere soup leaf
+  static constexpr size_t max_leaf_size = 8;
+  // Rays of a packet traced together by hit_packet, the widest kernel's lanes
+  static constexpr size_t max_packet_size = 8;
+
+private:
+  // Sphere data, one array per component
+  // NOTE: kept in double in float builds too, the kernels are double only;
+  // fixed arrays keep a soup in one piece of the scene arena, with nothing to
+  // free when the scene goes away
+  std::array<double, max_leaf_size> center_x, center_y, center_z, radius;
+  // Material of every sphere, owned by the scene
+  std::array<const material *, max_leaf_size> materials;
+  size_t count = 0;
+  // Bounding box enclosing all spheres
+  aabb bbox;
+
+  // Fill the record for a hit at t on sphere k
+  void fill_record(const ray &r, size_t k, double t, hit_record &record) const;
+
+public:
+  sphere_soup() = default;
+
+  // Add a sphere
+  // NOTE: a soup holds at most max_leaf_size spheres
+  void add(const point3 &center, double radius, const material *mat);
+  void add(const sphere &s);
+
+  // Number of spheres
+  size_t size() const;
+
+  // Determine the nearest sphere hit by the ray, testing several at once
+  bool hit(const ray &r, interval ray_t, hit_record &record) const override;
+  // Determine if the ray hits any sphere, all of them tested at once
+  bool occluded(const ray &r, interval ray_t) const override;
+  aabb bounding_box() const override;
+
+  // Optionally trace a packet of rays instead, testing several rays against
+  // one sphere at once; hits[k] and records[k] receive the result of rays[k]
+  // NOTE: pays off for coherent rays such as primary rays, the BVH traces
+  // one ray at a time and does not use it
+  void hit_packet(const ray *rays, size_t count, interval ray_t,
+                  hit_record *records, bool *hits) const;
+
+  // Name of the instruction set selected at runtime
+  static const char *simd_name();
+  // Use the named instruction set, "avx512", "avx2" or "scalar", instead of
+  // the selected one, e.g. to compare them in tests and benchmarks
+  // Returns false, keeping the current one, for an unknown name or one the
+  // CPU does not support
+  // NOTE: not thread safe, call it before rendering
+  static bool select_simd(const char *name);
+};
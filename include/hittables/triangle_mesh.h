@@ -0,0 +1,44 @@
+#pragma once
+// Indexed triangle mesh: vertices stored once and shared by the triangles
+// indexing them, intersected through a flat BVH of its own
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hittables/flat_bvh.h"
+#include "hittables/hittable.h"
+
+class triangle_mesh : public hittable {
+public:
+  // Vertex indices of a triangle, counter-clockwise seen from the front
+  using triangle = std::array<uint32_t, 3>;
+
+private:
+  std::vector<point3> vertices;
+  // Triangles, reordered so every leaf covers a contiguous range
+  std::vector<triangle> triangles;
+  // Hierarchy over the triangles
+  flat_bvh bvh;
+  // Material, owned by the scene
+  const material *mat;
+
+  // Triangles per leaf the build stops splitting at
+  static constexpr size_t max_leaf_size = 4;
+
+public:
+  // Take over the vertices and triangles and build the BVH over them
+  // NOTE: every index must be below vertices.size()
+  triangle_mesh(std::vector<point3> vertices, std::vector<triangle> triangles,
+                const material *mat);
+
+  size_t vertex_count() const;
+  size_t triangle_count() const;
+
+  // Determine the nearest triangle hit by the ray
+  bool hit(const ray &r, interval ray_t, hit_record &record) const override;
+  // Determine if the ray hits any triangle, stopping at the first
+  bool occluded(const ray &r, interval ray_t) const override;
+  aabb bounding_box() const override;
+};
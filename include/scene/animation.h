@@ -0,0 +1,30 @@
+#pragma once
+// Camera path of an animation: [Animation] frames and [[Keyframe]] tables,
+// interpolated linearly between keyframes
+
+#include <vector>
+
+#include <toml++/toml.hpp>
+
+#include "utils/vec3.h"
+
+// Camera position at one frame
+struct camera_keyframe {
+  int frame;
+  point3 look_from;
+  point3 look_at;
+};
+
+struct camera_path {
+  // Frames of the animation, numbered from 0
+  int frames = 0;
+  // Keyframes sorted by frame
+  std::vector<camera_keyframe> keyframes;
+
+  // Camera at a frame, held at the first and last keyframes outside them
+  camera_keyframe at(int frame) const;
+};
+
+// Load the [Animation] section and [[Keyframe]] tables of the config
+// Returns false and prints the error if they are invalid
+bool load_camera_path(const toml::table &config, camera_path &path);
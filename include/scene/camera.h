@@ -1,12 +1,33 @@
 #pragma once
 // Camera class, responsible for rendering the scene
 
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <toml++/toml.hpp>
 #include <unordered_map>
+#include <vector>
 
 #include "hittables/hittable.h"
+#include "scene/light_list.h"
+#include "scene/wavefront.h"
 #include "utils/color.h"
+#include "utils/counters.h"
+#include "utils/framebuffer.h"
+#include "utils/thread_pool.h"
+
+// Statistics of a render, filled when requested
+struct render_stats {
+  double seconds = 0;            // Wall time of the whole render
+  double first_tile_seconds = 0; // Wall time until the first tile finished
+  uint64_t samples = 0;          // Camera rays, one per pixel sample
+  uint64_t rays = 0;             // Ray segments traced, one per bounce
+  // Wall time spent on every tile, by row-major tile index, summed over passes
+  std::vector<double> tile_seconds;
+  // Hot path counters, all zero unless built with RAY_TRACING_COUNTERS
+  render_counters counters;
+};
 
 class camera {
 private:
@@ -16,21 +37,109 @@ private:
   vec3 u, v, w;                  // Camera frame basis vectors
   vec3 pixel_u, pixel_v;         // Pixel vectors
   vec3 pixel00_location;         // Location of the first pixel
+  real v_fov;                    // Vertical field of view in degrees
+  vec3 vup;                      // Camera-relative up direction
+
+  // Shutter interval, every camera ray gets a random time within it so
+  // moving objects are blurred; both 0 by default
+  real shutter_open, shutter_close;
 
   int samples_per_pixel;      // Sample per pixel for anti-aliasing
-  double pixel_samples_scale; // Scale for pixel samples (1 / samples_per_pixel)
+  real pixel_samples_scale;   // Scale for pixel samples (1 / samples_per_pixel)
 
   // Background colors
   std::unordered_map<std::string, color> background_colors;
 
   // Max ray bounce depth
   int max_depth;
+  // Bounce count after which paths are ended by Russian roulette
+  int roulette_depth;
+
+  // Base seed of the random generators, renders with the same seed and thread
+  // count are reproducible
+  uint64_t seed;
+
+  // Render threads of render_multithread, 0 means one per hardware thread
+  int render_threads;
+  // Edge length in pixels of the square tiles handed out to render threads
+  int tile_size;
+  // Render threads, started by the first render and kept for later renders
+  mutable std::unique_ptr<thread_pool> pool;
+
+  // Lights sampled at diffuse hits, owned by the scene; none by default
+  const light_list *lights = nullptr;
+
+  // Progressive rendering with adaptive sampling, samples_per_pixel is then
+  // the maximum per pixel
+  bool adaptive;
+  int min_samples_per_pixel; // Samples every pixel takes before it may stop
+  int samples_per_pass;      // Samples per pixel added by each later pass
+  double noise_threshold; // Pixels stop once the standard error of their mean
+                          // luminance falls below this
+
+  // Trace the samples of a tile as wavefront batches instead of one path at a
+  // time, in render_multithread and render_tile
+  bool wavefront;
+  // Reorder the paths of a wavefront batch before intersecting each bounce
+  // after the first, grouping them by origin and direction
+  bool sort_rays;
+
+  // Region of the image handed out to one render thread at a time
+  struct tile {
+    int index;              // Row-major tile index
+    int start_col, end_col; // Pixel columns [start_col, end_col)
+    int start_row, end_row; // Pixel rows [start_row, end_row)
+  };
+
+  // Tile at a row-major index
+  tile tile_at(int index) const;
+
+  // Tiles per image row
+  int tiles_per_row() const;
+
+  // Run render_tile on every tile of the image, spread over the render threads
+  // Adds the rays traced, tile times and counters to stats, and the first tile
+  // time if not yet set
+  void for_each_tile(const std::string &label,
+                     const std::function<void(const tile &)> &render_tile,
+                     render_stats *stats) const;
 
   // Called by the constructor
   void initialize(const toml::table &config);
 
-  // Ray color for each pixel
-  color ray_color(const ray &r, const int depth, const hittable &world) const;
+  // Ray color for each pixel, following the path for up to max_depth bounces
+  color ray_color(const ray &r, const hittable &world) const;
+
+  // Gather the light at the hit of current and scatter current into the next
+  // segment of the path, updating throughput, radiance and scatter_pdf
+  // Returns false if the path ends there, absorbed or by Russian roulette
+  bool bounce(const hit_record &record, int depth, const hittable &world,
+              ray &current, color &throughput, color &radiance,
+              real &scatter_pdf) const;
+
+  // Follow every path of the batch to its end, one stage at a time, adding
+  // the radiance of each to its pixel in pixel_sums
+  void trace_wavefront(wavefront_batch &batch, const hittable &world,
+                       color *pixel_sums) const;
+
+  // Average colors of the pixels of a tile, row by row, tracing one path at a
+  // time
+  // NOTE: the colors live in the scratch arena of the calling thread, valid
+  // until its next tile
+  const color *render_tile_paths(const tile &t, const hittable &world) const;
+
+  // Average colors of the pixels of a tile, row by row, traced in wavefront
+  // batches
+  // NOTE: the colors live in the scratch arena of the calling thread, valid
+  // until its next tile
+  const color *render_tile_wavefront(const tile &t,
+                                     const hittable &world) const;
+
+  // Background color of a ray that hits nothing
+  color background_color(const ray &r) const;
+
+  // Average color of samples_per_pixel rays through pixel i, j
+  color render_pixel(int i, int j, const hittable &world) const;
 
   // Returns the vector to a random point in the [-.5,-.5]-[+.5,+.5] unit square
   vec3 sample_square() const;
@@ -43,10 +152,56 @@ public:
   // Reading from a config file
   camera(const toml::table &config);
 
-  // Render the scene
-  void render(const hittable &world, std::ofstream &output_file) const;
+  // Move the camera to look_from, looking at look_at, keeping the field of
+  // view and up direction of the config
+  // Throws std::runtime_error if the points coincide or the view is parallel
+  // to the up direction
+  void set_view(const point3 &look_from, const point3 &look_at);
+
+  // Sample these lights directly at diffuse hits (next event estimation),
+  // weighted against scattering by multiple importance sampling
+  // NOTE: the lights must outlive every later render
+  void set_lights(const light_list *lights);
+
+  // Render the scene into a linear color framebuffer
+  framebuffer render(const hittable &world) const;
 
   // Multithreaded render function
-  void render_multithread(const hittable &world,
-                          std::ofstream &output_file) const;
+  framebuffer render_multithread(const hittable &world,
+                                 render_stats *stats = nullptr) const;
+
+  // Called after every progressive pass with the image so far
+  using pass_callback = std::function<void(const framebuffer &image, int pass)>;
+
+  // Progressive render function, renders in passes and stops sampling pixels
+  // whose noise falls below the threshold
+  framebuffer render_progressive(const hittable &world,
+                                 const pass_callback &on_pass,
+                                 render_stats *stats = nullptr) const;
+
+  // Whether [Render] adaptive selects progressive rendering
+  bool is_progressive() const;
+
+  // Rendered image size
+  int width() const;
+  int height() const;
+
+  // Render threads, with 0 in the config resolved to the hardware threads
+  int thread_count() const;
+
+  // Tiles of the image, handed out by row-major index
+  int tile_count() const;
+
+  // Pixels of one tile, linear RGB row by row, seeded like render_multithread
+  // so tiles rendered elsewhere assemble into the same image
+  std::vector<float> render_tile(const hittable &world, int index) const;
+
+  // Copy the pixels of a tile from render_tile into the image
+  // Returns false if index or the pixel count does not match a tile
+  bool set_tile(framebuffer &image, int index,
+                const std::vector<float> &pixels) const;
+
+  // Heatmap of stats.tile_seconds, every tile filled with its time on a black
+  // (fastest) to red, yellow and white (slowest) scale
+  framebuffer tile_heatmap(const render_stats &stats) const;
 };
\ No newline at end of file
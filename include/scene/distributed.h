@@ -0,0 +1,31 @@
+#pragma once
+// Distributed rendering: a coordinator hands out the tiles of the camera to
+// worker processes over sockets and assembles the image from their results
+//
+// Workers receive config.toml and its absolute directory from the coordinator,
+// so they need no working directory, but must see the OBJ files of meshes at
+// the same paths. Messages use the byte order of the machines, which must match
+
+#include <string>
+
+#include "scene/camera.h"
+#include "utils/framebuffer.h"
+
+// Render the image of cam with the workers connecting to address
+// directory is the absolute directory of config_text, workers read the OBJ
+// files of meshes relative to it
+// Tiles of workers that disconnect are handed out again, and once no tile is
+// left, tiles running much longer than average are also given to idle workers
+// stats, if given, gets the wall time, the time to the first tile and the
+// render time of every tile as measured by the workers
+// Throws std::runtime_error if the address can not be listened on
+framebuffer render_coordinator(const std::string &address,
+                               const std::string &config_text,
+                               const std::string &directory,
+                               const camera &cam,
+                               render_stats *stats = nullptr);
+
+// Connect to the coordinator at address and render tiles until the image is
+// done, with one connection per render thread of the config
+// Returns false and prints the error if the coordinator or config fails
+bool run_worker(const std::string &address);
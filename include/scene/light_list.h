@@ -0,0 +1,54 @@
+#pragma once
+// Light list: the emissive spheres of the scene, sampled directly at diffuse
+// hits (next event estimation) and weighted against scattering with multiple
+// importance sampling
+
+#include <cstddef>
+#include <vector>
+
+#include "utils/color.h"
+#include "utils/rtweekend.h"
+#include "utils/vec3.h"
+
+// Direction towards a light chosen by light_list::sample
+struct light_sample {
+  vec3 direction;  // Unit direction from the origin towards the light
+  real distance;   // Distance to the light surface along direction
+  color emission;  // Radiance emitted towards the origin
+  real pdf;        // Solid angle density of the list choosing direction
+};
+
+class light_list {
+  // Spherical light, emitting the same radiance from every surface point
+  struct sphere_light {
+    point3 center;
+    real radius;
+    color emission;
+  };
+
+  std::vector<sphere_light> lights;
+
+public:
+  // Add a spherical light
+  void add_sphere(const point3 &center, real radius, const color &emission);
+
+  bool empty() const;
+  size_t size() const;
+
+  // Choose a light uniformly, then a direction uniformly within the cone it
+  // subtends seen from origin
+  // Returns false if origin lies inside the chosen light
+  bool sample(const point3 &origin, light_sample &sample) const;
+
+  // Solid angle density of sample choosing the unit direction from origin,
+  // 0 if no light lies in that direction
+  real pdf(const point3 &origin, const vec3 &direction) const;
+};
+
+// Power heuristic (beta = 2) weight of a sample taken with density pdf, when
+// another technique would have taken it with density other_pdf
+inline real power_heuristic(real pdf, real other_pdf) {
+  const real a = pdf * pdf;
+  const real b = other_pdf * other_pdf;
+  return a + b > 0 ? a / (a + b) : 0;
+}
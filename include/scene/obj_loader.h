@@ -0,0 +1,16 @@
+#pragma once
+// Wavefront OBJ loader, reading the vertex positions and faces of a file line
+// by line into an indexed triangle mesh
+
+#include <string>
+#include <vector>
+
+#include "hittables/triangle_mesh.h"
+#include "utils/vec3.h"
+
+// Read the v and f lines of the OBJ file at path, splitting polygons into
+// triangle fans; texture coordinates, normals, groups and materials are
+// ignored
+// Returns false and prints the error if the file cannot be read or is invalid
+bool load_obj(const std::string &path, std::vector<point3> &vertices,
+              std::vector<triangle_mesh::triangle> &triangles);
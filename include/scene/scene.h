@@ -0,0 +1,90 @@
+#pragma once
+// Scene: the objects of the world and the materials they reference
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <toml++/toml.hpp>
+
+#include "hittables/hittable_list.h"
+#include "hittables/material.h"
+#include "scene/light_list.h"
+#include "utils/arena.h"
+
+// Parameters of a material, plain doubles so the same layout is stored in the
+// binary scene cache
+struct material_desc {
+  material_kind type;
+  uint32_t padding = 0;
+  double albedo[3]; // Emission of light
+  double parameter; // Fuzz of metal, refractive index of dielectric
+};
+
+// Parameters of a sphere, indexing its material
+struct sphere_desc {
+  double center[3];
+  double radius;
+  // Displacement of the center from time 0 to time 1, zero for still spheres
+  double motion[3];
+  uint32_t material;
+  uint32_t padding = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<material_desc> &&
+                  sizeof(material_desc) == 40,
+              "material_desc is stored as is in the scene cache");
+static_assert(std::is_trivially_copyable_v<sphere_desc> &&
+                  sizeof(sphere_desc) == 64,
+              "sphere_desc is stored as is in the scene cache");
+
+// Scene parameters as read from the config, before any object is created
+struct scene_desc {
+  // Distinct materials, spheres with equal parameters share one
+  std::vector<material_desc> materials;
+  std::vector<sphere_desc> spheres;
+};
+
+struct scene {
+  // Materials, objects (including the BVHs of the [[Object]] tables shared by
+  // instances) and BVH nodes of the scene, created next to each other in the
+  // order they are built and freed together with the scene; everything else
+  // refers to them by plain pointers
+  arena memory;
+  // Objects of the world, in memory
+  hittable_list objects;
+  // Still [[Sphere]] tables of light material, sampled directly by the camera
+  light_list lights;
+};
+
+// Read the [[Sphere]] tables of the config, merging equal materials
+// Returns false and prints the error if any sphere is invalid
+bool load_scene_desc(const toml::table &config, scene_desc &desc);
+
+// Create the materials and spheres of the parameter arrays
+void build_scene(const material_desc *materials, size_t material_count,
+                 const sphere_desc *spheres, size_t sphere_count,
+                 scene &world);
+
+// Add the triangle meshes of the [[Mesh]] tables to the scene, create the
+// shared objects of the [[Object]] tables, and add an instance to the scene
+// for every [[Instance]] table
+// OBJ files of meshes are read relative to directory
+// Returns false and prints the error if any mesh, object or instance is
+// invalid
+bool load_objects(const toml::table &config, const std::string &directory,
+                  scene &world);
+
+// Bounding volume hierarchy over the objects of the world, created in its
+// memory and taking world.objects over: a primitive_bvh<sphere> when every
+// object is a still sphere, so no virtual call is made below its root, a
+// bvh_node of any hittables with sphere soup leaves otherwise
+const hittable &build_bvh(scene &world);
+
+// Load the [[Sphere]], [[Mesh]], [[Object]] and [[Instance]] tables of the
+// config into the scene, OBJ files are read relative to directory
+// Returns false and prints the error if any of them is invalid
+bool load_scene(const toml::table &config, scene &world,
+                const std::string &directory = ".");
@@ -0,0 +1,44 @@
+#pragma once
+// Binary scene cache: the material and sphere parameters of a config.toml,
+// written after the first load and memory mapped by later loads as long as the
+// config text is unchanged, so large scenes skip parsing the [[Sphere]] tables
+//
+// Layout (native byte order): scene_cache_header, material_desc[], then
+// sphere_desc[], each array starting at an 8 byte boundary
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <toml++/toml.hpp>
+
+#include "scene/scene.h"
+
+// Hash of the config text, stored in the cache to detect changes
+uint64_t scene_source_hash(std::string_view text);
+
+// Set stripped to the config text without its [[Sphere]] tables
+// Returns false if the text has anything the line scan does not recognize,
+// such as multi-line strings, quoted keys in table headers or spheres outside
+// of [[Sphere]] tables; the whole text must be parsed then
+bool strip_sphere_tables(std::string_view text, std::string &stripped);
+
+// Build the scene of the cache at path, if it was written from a config with
+// this source hash
+// Returns false if the cache is missing, stale or invalid
+bool load_scene_cache(const std::string &path, uint64_t source_hash,
+                      scene &world);
+
+// Write the scene parameters to the cache at path
+// Returns false and prints the error if the file cannot be written
+bool save_scene_cache(const std::string &path, uint64_t source_hash,
+                      const scene_desc &desc);
+
+// Read config_path into config and load its scene, from the cache at
+// cache_path when it is up to date, otherwise from the [[Sphere]] tables,
+// then refreshing the cache. An empty cache_path disables the cache
+// [[Mesh]], [[Object]] and [[Instance]] tables are always read from the config
+// Returns false and prints the error if the config or scene is invalid
+bool load_scene_cached(const std::string &config_path,
+                       const std::string &cache_path, toml::table &config,
+                       scene &world);
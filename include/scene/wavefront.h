@@ -0,0 +1,59 @@
+#pragma once
+// Wavefront path tracing: a batch of paths advances one bounce at a time, and
+// every stage runs over the whole batch before the next (intersect every
+// path, bin the hits by material, then scatter the bins one material at a
+// time), so the same code and data stay hot instead of alternating per path
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hittables/hittable.h"
+#include "utils/color.h"
+#include "utils/counters.h"
+#include "utils/ray.h"
+
+// State of one path between bounces
+struct wavefront_path {
+  ray current;      // Segment traced by the next intersect
+  color throughput; // Product of the attenuations along the path so far
+  color radiance;   // Light gathered so far
+  // Density of the previous scatter choosing current, 0 after the camera and
+  // specular bounces
+  real scatter_pdf;
+  uint32_t pixel; // Pixel of the batch the path adds its radiance to
+};
+
+// Paths of a batch and the queues moving them between stages
+struct wavefront_batch {
+  std::vector<wavefront_path> paths;
+  // Hit of the current segment, by path
+  std::vector<hit_record> hits;
+  // Paths to intersect next, refilled by the scatter stage
+  std::vector<uint32_t> active;
+  // Paths whose current segment hit nothing, filled by intersect
+  std::vector<uint32_t> missed;
+  // Paths by the material_kind of their hit, filled by intersect
+  std::array<std::vector<uint32_t>, size_t(material_kind::count)> bins;
+  // Scratch of sort_active, kept between sorts for its memory
+  std::vector<uint32_t> sort_keys;
+  std::vector<uint32_t> sorted;
+  std::vector<uint32_t> key_counts;
+
+  // Remove every path, keeping the memory for the next batch
+  void clear();
+
+  // Start a path at a camera ray, active for the next intersect
+  void add(const ray &r, uint32_t pixel);
+
+  // Reorder the active paths by the octant of their direction, then by the
+  // cell of their origin in a grid over the box of all active origins (in
+  // Morton order), so paths traced one after another start close together,
+  // head the same way and mostly visit the same BVH nodes
+  void sort_active();
+
+  // Intersect the current segment of every active path with the world, moving
+  // the path to the bin of the material hit or to missed
+  void intersect(const hittable &world);
+};
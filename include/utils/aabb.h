@@ -0,0 +1,99 @@
+#pragma once
+// Axis-aligned bounding box
+
+#include "utils/interval.h"
+#include "utils/ray.h"
+#include "utils/vec3.h"
+
+class aabb {
+public:
+  // One interval per axis
+  interval x, y, z;
+
+  // Constructors
+  // Default box is empty, since intervals are empty by default
+  constexpr aabb() {}
+  constexpr aabb(const interval &x, const interval &y, const interval &z)
+      : x(x), y(y), z(z) {}
+  // Treat the two points a and b as extrema for the bounding box, so we don't
+  // require a particular minimum/maximum coordinate order
+  constexpr aabb(const point3 &a, const point3 &b)
+      : x(a[0] <= b[0] ? interval(a[0], b[0]) : interval(b[0], a[0])),
+        y(a[1] <= b[1] ? interval(a[1], b[1]) : interval(b[1], a[1])),
+        z(a[2] <= b[2] ? interval(a[2], b[2]) : interval(b[2], a[2])) {}
+  // Smallest box enclosing both boxes
+  constexpr aabb(const aabb &box0, const aabb &box1)
+      : x(box0.x, box1.x), y(box0.y, box1.y), z(box0.z, box1.z) {}
+
+  // Get interval of specific axis (0: x, 1: y, 2: z)
+  constexpr const interval &axis_interval(int n) const {
+    if (n == 1) {
+      return y;
+    }
+    if (n == 2) {
+      return z;
+    }
+    return x;
+  }
+
+  // Index of the longest axis of the box
+  constexpr int longest_axis() const {
+    if (x.size() > y.size()) {
+      return x.size() > z.size() ? 0 : 2;
+    }
+    return y.size() > z.size() ? 1 : 2;
+  }
+
+  // Center point of the box
+  constexpr point3 centroid() const {
+    return point3(0.5 * (x.min + x.max), 0.5 * (y.min + y.max),
+                  0.5 * (z.min + z.max));
+  }
+
+  // Surface area, used by the surface area heuristic
+  constexpr real surface_area() const {
+    const real dx = x.size();
+    const real dy = y.size();
+    const real dz = z.size();
+    return 2.0 * (dx * dy + dy * dz + dz * dx);
+  }
+
+  // Determine if the ray hits the box within ray_t (slab test)
+  bool hit(const ray &r, interval ray_t) const {
+    const point3 &ray_origin = r.origin();
+    const vec3 &ray_direction = r.direction();
+
+    for (int axis = 0; axis < 3; axis++) {
+      const interval &ax = axis_interval(axis);
+      // Division by zero yields +-infinity, which the comparisons handle
+      const real inverse_direction = real(1) / ray_direction[axis];
+
+      // Ray parameters where it enters and leaves the slab
+      const real t0 = (ax.min - ray_origin[axis]) * inverse_direction;
+      const real t1 = (ax.max - ray_origin[axis]) * inverse_direction;
+
+      // Shrink ray_t to the overlap with the slab
+      if (t0 < t1) {
+        ray_t.min = t0 > ray_t.min ? t0 : ray_t.min;
+        ray_t.max = t1 < ray_t.max ? t1 : ray_t.max;
+      } else {
+        ray_t.min = t1 > ray_t.min ? t1 : ray_t.min;
+        ray_t.max = t0 < ray_t.max ? t0 : ray_t.max;
+      }
+
+      // Empty overlap, the ray misses the box
+      if (ray_t.max <= ray_t.min) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Two static special boxes
+  static const aabb empty, universe;
+};
+
+inline constexpr aabb aabb::empty = aabb();
+inline constexpr aabb aabb::universe =
+    aabb(interval::universe, interval::universe, interval::universe);
@@ -0,0 +1,88 @@
+#pragma once
+// Arena (bump) allocator: objects are placed one after another in large
+// blocks and freed all at once, by reset or when the arena is destroyed, so
+// objects created together also lie together in memory
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class arena {
+  // Memory objects are placed in
+  struct block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  // Object whose destructor must run when the arena is reset
+  struct finalizer {
+    void (*destroy)(void *object);
+    void *object;
+  };
+
+  std::vector<block> blocks;
+  size_t current = 0;    // Block new objects are placed in
+  size_t offset = 0;     // Bytes used of the current block
+  size_t used_bytes = 0; // Bytes handed out since the last reset
+  // Size of new blocks, larger allocations get a block of their own
+  size_t block_size;
+  std::vector<finalizer> finalizers;
+
+  // Place size bytes at alignment in the current block, nullptr if full
+  void *place(size_t size, size_t alignment);
+
+public:
+  static constexpr size_t default_block_size = size_t(1) << 16;
+
+  explicit arena(size_t block_size = default_block_size);
+
+  arena(const arena &) = delete;
+  arena &operator=(const arena &) = delete;
+
+  // Destroy every object and free the blocks
+  ~arena();
+
+  // Uninitialized memory of size bytes, aligned to alignment (a power of two)
+  void *allocate(size_t size, size_t alignment);
+
+  // Construct a T in the arena, destroyed by reset or the arena's destructor
+  // NOTE: only types with a non-trivial destructor are recorded for that, so
+  // freeing trivially destructible objects costs nothing per object
+  template <class T, class... Args> T *create(Args &&...args);
+
+  // Array of count value-initialized Ts, which must need no destructor
+  template <class T> T *create_array(size_t count);
+
+  // Destroy every object in reverse order of creation, keeping the blocks for
+  // the objects created next
+  void reset();
+
+  // Bytes handed out since the last reset, and blocks held
+  size_t bytes_used() const;
+  size_t block_count() const;
+};
+
+// Construct a T in the arena
+template <class T, class... Args> T *arena::create(Args &&...args) {
+  T *object = new (allocate(sizeof(T), alignof(T)))
+      T(std::forward<Args>(args)...);
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    finalizers.push_back(
+        finalizer{[](void *p) { static_cast<T *>(p)->~T(); }, object});
+  }
+  return object;
+}
+
+// Array of count value-initialized Ts
+template <class T> T *arena::create_array(size_t count) {
+  static_assert(std::is_trivially_destructible_v<T>,
+                "arrays are freed without running destructors");
+  T *objects = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+  for (size_t k = 0; k < count; k++) {
+    new (objects + k) T();
+  }
+  return objects;
+}
@@ -1,11 +1,17 @@
 #pragma once
 
-#include <ostream>
-
 #include "utils/vec3.h"
 
 // Color type alias
 using color = vec3;
 
-// Write a pixel of color to the output stream
-void write_color(std::ostream &os, const color &pixel_color);
\ No newline at end of file
+// Relative luminance of a linear color
+constexpr real luminance(const color &c) {
+  return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
+// Convert a linear color component to gamma space (gamma 2)
+double linear_to_gamma(double linear_component);
+
+// Translate a linear color component to a gamma corrected byte [0,255]
+unsigned char color_component_to_byte(double linear_component);
@@ -0,0 +1,70 @@
+#pragma once
+// Hot path counters, compiled in only when RAY_TRACING_COUNTERS is defined
+// (`xmake f --counters=y`), otherwise every count_* call is empty
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "hittables/material.h"
+
+// Counters of one thread, or of a whole render once merged
+// Rays traced are counted in render_stats in every build
+struct render_counters {
+  // Paths of this many segments or more share the last histogram bin
+  static constexpr int path_length_bins = 32;
+
+  uint64_t object_tests = 0;      // Ray-primitive intersection tests
+  uint64_t bvh_nodes_visited = 0; // BVH nodes whose box was tested
+  // Scatter calls per material_kind
+  std::array<uint64_t, size_t(material_kind::count)> scatters{};
+  // Paths by their number of ray segments
+  std::array<uint64_t, path_length_bins> path_lengths{};
+
+  // Add the counts of other
+  void merge(const render_counters &other);
+};
+
+#ifdef RAY_TRACING_COUNTERS
+inline constexpr bool counters_enabled = true;
+#else
+inline constexpr bool counters_enabled = false;
+#endif
+
+// Counters of the current thread, merged by the camera after every worker
+inline thread_local render_counters thread_counters;
+
+// Count ray-primitive intersection tests
+inline void count_object_tests(uint64_t tests) {
+  if constexpr (counters_enabled) {
+    thread_counters.object_tests += tests;
+  }
+}
+
+// Count a visited BVH node
+inline void count_bvh_node() {
+  if constexpr (counters_enabled) {
+    thread_counters.bvh_nodes_visited++;
+  }
+}
+
+// Count a scatter call of a material
+inline void count_scatter(material_kind kind) {
+  if constexpr (counters_enabled) {
+    thread_counters.scatters[size_t(kind)]++;
+  }
+}
+
+// Count a finished path of length ray segments
+inline void count_path(int length) {
+  if constexpr (counters_enabled) {
+    const int bin = length < render_counters::path_length_bins
+                        ? length
+                        : render_counters::path_length_bins - 1;
+    thread_counters.path_lengths[bin]++;
+  }
+}
+
+// Print the counters, one per line
+std::ostream &operator<<(std::ostream &out, const render_counters &counters);
@@ -0,0 +1,27 @@
+#pragma once
+// Linear color framebuffer, filled by the camera and encoded by image writers
+
+#include <vector>
+
+#include "utils/color.h"
+
+class framebuffer {
+  int image_width, image_height;
+  // Linear RGB components, row by row from the upper left pixel
+  std::vector<float> data;
+
+public:
+  // Constructor, all pixels start black
+  framebuffer(int width, int height);
+
+  // Image size in pixels
+  int width() const;
+  int height() const;
+
+  // Get and set the pixel in column i, row j
+  color get(int i, int j) const;
+  void set(int i, int j, const color &pixel);
+
+  // Raw RGB components, width * height * 3 floats
+  const float *pixels() const;
+};
@@ -0,0 +1,24 @@
+#pragma once
+// Image file encoders for the framebuffer
+
+#include <ostream>
+#include <string>
+
+#include "utils/framebuffer.h"
+
+// Supported output formats
+enum class image_format {
+  ppm, // Binary (P6) PPM, 8-bit gamma corrected
+  png, // PNG, 8-bit gamma corrected
+  pfm, // Portable float map, linear HDR
+};
+
+// Parse a format name ("ppm", "png" or "pfm"), throws on unknown names
+image_format image_format_from_string(const std::string &name);
+
+// File extension of the format, without the dot
+std::string image_format_extension(image_format format);
+
+// Encode the image to the stream, which must be opened in binary mode
+void write_image(std::ostream &os, const framebuffer &image,
+                 image_format format);
@@ -1,23 +1,36 @@
 #pragma once
 // Interval
 
+#include "utils/rtweekend.h"
+
 // A class representing a closed interval [a, b].
 class interval {
 public:
-  double min, max;
+  real min, max;
 
   // Constructor
-  interval();
-  interval(double min, double max);
+  // Default empty interval
+  constexpr interval() : min(+infinity), max(-infinity) {}
+  constexpr interval(real min, real max) : min(min), max(max) {}
+  // Smallest interval enclosing both intervals
+  constexpr interval(const interval &a, const interval &b)
+      : min(a.min <= b.min ? a.min : b.min),
+        max(a.max >= b.max ? a.max : b.max) {}
 
   // Size of the interval
-  double size() const;
+  constexpr real size() const { return max - min; }
 
   // Contains and surrounds
-  bool contains(double x) const;
-  bool surrounds(double x) const;
-  double clamp(double x) const;
+  constexpr bool contains(real x) const { return min <= x && x <= max; }
+  constexpr bool surrounds(real x) const { return min < x && x < max; }
+  constexpr real clamp(real x) const {
+    return x < min ? min : (x > max ? max : x);
+  }
 
   // Two static special intervals
   static const interval empty, universe;
 };
+
+// Constant initialized, so usable from static initializers of any file
+inline constexpr interval interval::empty = interval(+infinity, -infinity);
+inline constexpr interval interval::universe = interval(-infinity, +infinity);
@@ -0,0 +1,54 @@
+#pragma once
+// Small-state pseudo random number generator (xoshiro256**)
+
+#include <cstdint>
+
+class random_generator {
+  // Generator state, must not be all zero
+  uint64_t state[4] = {};
+
+  // Rotate x left by k bits
+  static constexpr uint64_t rotate_left(const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+public:
+  // Constructor, seeding the state from a single value
+  // NOTE: constexpr so a thread_local generator is initialized statically and
+  // every access skips the lazy initialization check
+  constexpr explicit random_generator(uint64_t seed = 0) { this->seed(seed); }
+
+  // Reset the state from a single value, expanded with splitmix64 so that
+  // close seeds (e.g. consecutive thread indices) still give unrelated
+  // sequences
+  constexpr void seed(uint64_t seed) {
+    for (auto &s : state) {
+      seed += 0x9e3779b97f4a7c15;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      s = z ^ (z >> 31);
+    }
+  }
+
+  // Returns the next random 64-bit integer
+  uint64_t next() {
+    const uint64_t result = rotate_left(state[1] * 5, 7) * 9;
+    const uint64_t t = state[1] << 17;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotate_left(state[3], 45);
+
+    return result;
+  }
+
+  // Returns a random real in [0,1).
+  double next_double() {
+    // Use the upper 53 bits, which fill the mantissa of a double exactly
+    return (next() >> 11) * 0x1.0p-53;
+  }
+};
@@ -1,18 +1,40 @@
 #pragma once
 
+#include <cstdint>
 #include <limits>
 
+#include "utils/random.h"
+
+// Scalar type of the geometry and shading math, float when built with
+// RAY_TRACING_FLOAT (the ray-tracing-demo-cpu-float target), double otherwise
+#ifdef RAY_TRACING_FLOAT
+using real = float;
+#else
+using real = double;
+#endif
+
 // Constants
 
-const double infinity = std::numeric_limits<double>::infinity();
-const double pi = 3.1415926535897932385;
+constexpr real infinity = std::numeric_limits<real>::infinity();
+constexpr real pi = real(3.1415926535897932385);
 
 // Utility Functions
 
-double degrees_to_radians(double degrees);
+constexpr real degrees_to_radians(real degrees) {
+  return degrees * pi / real(180);
+}
+
+// Random generator of the calling thread
+// NOTE: every thread owns its generator, so threads never share random state
+inline thread_local random_generator thread_generator;
+
+// Seed the random generator of the calling thread
+inline void seed_random(uint64_t seed) { thread_generator.seed(seed); }
 
 // Returns a random real in [0,1).
-double random_double();
+inline double random_double() { return thread_generator.next_double(); }
 
 // Returns a random real in [min,max).
-double random_double(double min, double max);
\ No newline at end of file
+inline double random_double(double min, double max) {
+  return min + (max - min) * random_double();
+}
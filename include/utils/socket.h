@@ -0,0 +1,47 @@
+#pragma once
+// Stream sockets for distributed rendering (POSIX only)
+//
+// Addresses are "host:port" for TCP or "unix:/path" for a Unix domain socket.
+// Listening addresses may leave out the host (":port" or "port") to listen on
+// every interface
+
+#include <cstddef>
+#include <string>
+
+// Stream socket, closed on destruction
+class socket_handle {
+  int fd = -1;
+
+public:
+  socket_handle() = default;
+  explicit socket_handle(int fd) : fd(fd) {}
+  socket_handle(socket_handle &&other) noexcept;
+  socket_handle &operator=(socket_handle &&other) noexcept;
+  socket_handle(const socket_handle &) = delete;
+  socket_handle &operator=(const socket_handle &) = delete;
+  ~socket_handle();
+
+  bool valid() const { return fd >= 0; }
+  int get() const { return fd; }
+
+  // Stop sending and receiving, waking up any thread blocked on the socket
+  void shutdown() const;
+
+  // Send or receive exactly size bytes
+  // Returns false if the connection failed or was closed
+  bool send_all(const void *data, size_t size) const;
+  bool receive_all(void *data, size_t size) const;
+};
+
+// Listen for connections on address
+// A stale socket file at a Unix path is replaced, any other file is kept
+// Throws std::runtime_error if the address is invalid or in use
+socket_handle listen_socket(const std::string &address);
+
+// Accept a connection, waiting at most timeout_ms milliseconds
+// Returns an invalid handle on timeout
+socket_handle accept_socket(const socket_handle &listener, int timeout_ms);
+
+// Connect to address
+// Throws std::runtime_error if the address is invalid or unreachable
+socket_handle connect_socket(const std::string &address);
@@ -0,0 +1,41 @@
+#pragma once
+// Fixed set of threads running the same task together, kept alive between
+// tasks so repeated renders do not start new threads
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class thread_pool {
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable task_ready, task_finished;
+  // Task of the current run, valid while running > 0
+  const std::function<void()> *task = nullptr;
+  uint64_t generation = 0; // Incremented by every run
+  int running = 0;         // Threads still running the current task
+  bool stopping = false;
+
+  // Loop of every thread, waiting for runs until the pool is destroyed
+  void worker_loop();
+
+public:
+  // Start the threads
+  explicit thread_pool(int thread_count);
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  // Stop and join the threads
+  ~thread_pool();
+
+  int size() const;
+
+  // Run task on every thread at once and wait until all of them return
+  // NOTE: not reentrant, one run at a time
+  void run_on_all(const std::function<void()> &task);
+};
@@ -0,0 +1,54 @@
+#pragma once
+// Affine transform: a 3x3 linear part followed by a translation
+
+#include "utils/aabb.h"
+#include "utils/rtweekend.h"
+#include "utils/vec3.h"
+
+class affine_transform {
+  // Linear part, row-major
+  real m[3][3];
+  // Translation, applied after the linear part
+  vec3 offset;
+
+public:
+  // Identity
+  affine_transform();
+
+  // Move by offset
+  static affine_transform translation(const vec3 &offset);
+  // Rotate by degrees about the x, then the y, then the z axis
+  static affine_transform rotation(const vec3 &degrees);
+  // Scale along each axis, factors must not be zero
+  static affine_transform scaling(const vec3 &factors);
+
+  // Transform applying other first, then this
+  affine_transform operator*(const affine_transform &other) const;
+
+  // Inverse transform
+  // NOTE: the linear part is assumed to be invertible
+  affine_transform inverse() const;
+
+  // Transform a point
+  point3 apply_point(const point3 &p) const {
+    return apply_vector(p) + offset;
+  }
+
+  // Transform a direction, ignoring the translation
+  vec3 apply_vector(const vec3 &v) const {
+    return vec3(m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+                m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+                m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]);
+  }
+
+  // Multiply by the transpose of the linear part, normals are transformed by
+  // the transpose of the inverse transform
+  vec3 apply_transposed(const vec3 &v) const {
+    return vec3(m[0][0] * v[0] + m[1][0] * v[1] + m[2][0] * v[2],
+                m[0][1] * v[0] + m[1][1] * v[1] + m[2][1] * v[2],
+                m[0][2] * v[0] + m[1][2] * v[1] + m[2][2] * v[2]);
+  }
+
+  // Box enclosing the transformed box
+  aabb apply_box(const aabb &box) const;
+};
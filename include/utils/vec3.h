@@ -1,92 +1,148 @@
 #pragma once
 
 #include <array>
+#include <cmath>
 #include <ostream>
 
 #include <toml++/toml.hpp>
 
+#include "utils/rtweekend.h"
+
+// NOTE: all math below is defined inline so it can be inlined into the hot
+// intersection and shading code of every translation unit. Nothing here
+// throws, callers make sure divisors and lengths are non-zero.
+
 class vec3 {
   // A array with fixed length 3
-  std::array<double, 3> e;
+  std::array<real, 3> e;
 
 public:
   // Initializers
-  vec3();
-  vec3(double e0, double e1, double e2);
+  constexpr vec3() : e{0, 0, 0} {}
+  constexpr vec3(real e0, real e1, real e2) : e{e0, e1, e2} {}
+  // From an array of three numbers, integers or floating point
+  // NOTE: throws std::runtime_error for another size or a non-number, use
+  // array_to_vec3 to check config values
   vec3(const toml::array &arr);
 
   // Get
-  double x() const;
-  double y() const;
-  double z() const;
+  constexpr real x() const { return e[0]; }
+  constexpr real y() const { return e[1]; }
+  constexpr real z() const { return e[2]; }
 
   // Negate
-  vec3 operator-() const;
+  constexpr vec3 operator-() const { return vec3(-e[0], -e[1], -e[2]); }
   // Get specific coordinate using index (const)
-  double operator[](int i) const;
+  constexpr real operator[](int i) const { return e[i]; }
   // Get specific coordinate using index (non-const, reference)
-  double &operator[](int i);
+  constexpr real &operator[](int i) { return e[i]; }
 
   // Add with others
-  vec3 operator+(const vec3 &v) const;
+  constexpr vec3 operator+(const vec3 &v) const {
+    return vec3(e[0] + v.e[0], e[1] + v.e[1], e[2] + v.e[2]);
+  }
 
   // Subtract with others
-  vec3 operator-(const vec3 &v) const;
+  constexpr vec3 operator-(const vec3 &v) const {
+    return vec3(e[0] - v.e[0], e[1] - v.e[1], e[2] - v.e[2]);
+  }
 
   // Multiply with others
-  vec3 operator*(const vec3 &v) const;
+  constexpr vec3 operator*(const vec3 &v) const {
+    return vec3(e[0] * v.e[0], e[1] * v.e[1], e[2] * v.e[2]);
+  }
   // Add together, write to self
-  vec3 &operator+=(const vec3 &v);
+  constexpr vec3 &operator+=(const vec3 &v) {
+    e[0] += v.e[0];
+    e[1] += v.e[1];
+    e[2] += v.e[2];
+    return *this;
+  }
 
   // Subtract together, write to self
-  vec3 &operator-=(const vec3 &v);
+  constexpr vec3 &operator-=(const vec3 &v) {
+    e[0] -= v.e[0];
+    e[1] -= v.e[1];
+    e[2] -= v.e[2];
+    return *this;
+  }
 
   // Multiply together, write to self
-  vec3 &operator*=(const vec3 &v);
+  constexpr vec3 &operator*=(const vec3 &v) {
+    e[0] *= v.e[0];
+    e[1] *= v.e[1];
+    e[2] *= v.e[2];
+    return *this;
+  }
 
   // Multiply by a scalar (*=)
-  vec3 &operator*=(const double t);
+  constexpr vec3 &operator*=(const real t) {
+    e[0] *= t;
+    e[1] *= t;
+    e[2] *= t;
+    return *this;
+  }
 
   // Divide by a scalar (/=)
-  vec3 &operator/=(const double t);
+  constexpr vec3 &operator/=(const real t) { return *this *= 1 / t; }
 
   // Length in square
-  double length_squared() const;
+  constexpr real length_squared() const {
+    return e[0] * e[0] + e[1] * e[1] + e[2] * e[2];
+  }
 
   // Length
-  double length() const;
+  real length() const { return std::sqrt(length_squared()); }
 
   // Random vec3
   static vec3 random();
-  static vec3 random(double min, double max);
+  static vec3 random(real min, real max);
 
   // Return true if the vector is close to zero in all dimensions
-  bool near_zero() const;
+  bool near_zero() const {
+    // Note that we compare the component-wise with a small value
+    const real s = 1e-8;
+    return (std::fabs(e[0]) < s) && (std::fabs(e[1]) < s) &&
+           (std::fabs(e[2]) < s);
+  }
 };
 
 // point3 is just an alias for vec3, but useful for geometric clarity in the
 // code.
 using point3 = vec3;
 
+// Read an array of three finite numbers, integers or floating point, into v
+// Returns false, leaving v unchanged, for another size, a non-number or a
+// value that is not finite
+bool array_to_vec3(const toml::array &arr, vec3 &v);
+
 // Vector Utility Functions
 
 // Output vec3
 std::ostream &operator<<(std::ostream &out, const vec3 &v);
 
 // Multiply with a scalar
-vec3 operator*(double t, const vec3 &v);
+constexpr vec3 operator*(real t, const vec3 &v) {
+  return vec3(t * v.x(), t * v.y(), t * v.z());
+}
 // Multiply with a scalar
-vec3 operator*(const vec3 &v, double t);
+constexpr vec3 operator*(const vec3 &v, real t) { return t * v; }
 // Divide by a scalar
-vec3 operator/(const vec3 &v, double t);
+constexpr vec3 operator/(const vec3 &v, real t) { return (1 / t) * v; }
 
 // Dot product
-double dot(const vec3 &u, const vec3 &v);
+constexpr real dot(const vec3 &u, const vec3 &v) {
+  return u.x() * v.x() + u.y() * v.y() + u.z() * v.z();
+}
 // Cross product
-vec3 cross(const vec3 &u, const vec3 &v);
+constexpr vec3 cross(const vec3 &u, const vec3 &v) {
+  return vec3(u.y() * v.z() - u.z() * v.y(), u.z() * v.x() - u.x() * v.z(),
+              u.x() * v.y() - u.y() * v.x());
+}
 
 // Unit vector
-vec3 unit_vector(vec3 v);
+// NOTE: v must not be zero-length
+inline vec3 unit_vector(const vec3 &v) { return v / v.length(); }
 
 // Generate random unit vector
 vec3 random_unit_vector();
@@ -97,8 +153,22 @@ vec3 random_in_hemisphere(const vec3 &normal);
 // Reflect the vector v around the normal n
 // v: incident vector
 // n: normal vector
-vec3 reflect(const vec3 &v, const vec3 &n);
+constexpr vec3 reflect(const vec3 &v, const vec3 &n) {
+  // dot(v, n): dot product of v and n (a scalar, negative)
+  // dot(v, n) * n: projection of v onto n (a vector), which points into the
+  // surface
+  // -2 * dot(v, n) * n: twice the projection of v onto n (a vector), which
+  // points out of the surface
+  // v - 2 * dot(v, n) * n: the reflection of v around n
+  return v - 2 * dot(v, n) * n;
+}
 
 // Refract the vector uv around the normal n, with the refractive index
 // etai_over_etat
-vec3 refract(const vec3 &uv, const vec3 &n, double etai_over_etat);
+inline vec3 refract(const vec3 &uv, const vec3 &n, real etai_over_etat) {
+  const real cos_theta = std::fmin(dot(-uv, n), real(1));
+  const vec3 r_out_perpendicular = etai_over_etat * (uv + cos_theta * n);
+  const vec3 r_out_parallel =
+      -std::sqrt(std::fabs(real(1) - r_out_perpendicular.length_squared())) * n;
+  return r_out_perpendicular + r_out_parallel;
+}
@@ -0,0 +1,502 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BENCHMARK_FORK 1
+#endif
+
+#include <argparse/argparse.hpp>
+#include <toml++/toml.hpp>
+
+#include "scene/camera.h"
+#include "scene/scene.h"
+#include "utils/color.h"
+#include "utils/rtweekend.h"
+#include "utils/vec3.h"
+
+// Reference scenes rendered with fixed settings, reporting rays per second and
+// friends as JSON so that runs on different commits can be compared
+
+namespace {
+
+// A reference scene: camera config text and a function filling the scene
+struct reference_scene {
+  std::string name;
+  std::string camera_config;
+  std::function<bool(scene &)> build;
+};
+
+// Seconds elapsed since start
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Peak resident memory of the process in bytes, 0 if unknown
+// Every scene runs in its own process, so this is the peak of one scene
+uint64_t peak_memory_bytes() {
+#ifdef BENCHMARK_FORK
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  // Bytes on macOS
+  return uint64_t(usage.ru_maxrss);
+#else
+  // Kilobytes on Linux and the BSDs
+  return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+// TOML array text of a vector, floats keep their decimal point
+std::string toml_vec3(const vec3 &v) {
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(3) << '[' << v.x() << ", " << v.y()
+       << ", " << v.z() << ']';
+  return text.str();
+}
+
+// Integrator settings of every scene, from the command line
+struct integrator_options {
+  bool wavefront = false;
+  bool sort_rays = false;
+};
+
+// TOML text of a boolean
+const char *toml_bool(bool value) { return value ? "true" : "false"; }
+
+// Camera config of a generated scene
+std::string camera_config(int width, int samples, const point3 &look_from,
+                          const point3 &look_at, double v_fov,
+                          const integrator_options &integrator) {
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(3);
+  text << "[Image]\n"
+       << "aspect_ratio_width = 16.0\n"
+       << "aspect_ratio_height = 9.0\n"
+       << "image_width = " << width << "\n"
+       << "[Camera]\n"
+       << "v_fov = " << v_fov << "\n"
+       << "look_from = " << toml_vec3(look_from) << "\n"
+       << "look_at = " << toml_vec3(look_at) << "\n"
+       << "vup = [0.0, 1.0, 0.0]\n"
+       << "samples_per_pixel = " << samples << "\n"
+       << "[Color]\n"
+       << "white = [1.0, 1.0, 1.0]\n"
+       << "blue = [0.529, 0.808, 0.922]\n"
+       << "[Ray]\n"
+       << "max_depth = 20\n"
+       << "roulette_depth = 3\n"
+       << "[Render]\n"
+       << "wavefront = " << toml_bool(integrator.wavefront) << "\n"
+       << "sort_rays = " << toml_bool(integrator.sort_rays) << "\n";
+  return text.str();
+}
+
+// Config text of config_template.toml with the image width, samples and
+// integrator settings replaced, empty if the file cannot be read
+std::string template_config(const std::string &path, int width, int samples,
+                            const integrator_options &integrator) {
+  std::ifstream file(path);
+  if (!file) {
+    return "";
+  }
+
+  std::ostringstream text;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.rfind("image_width", 0) == 0) {
+      line = "image_width = " + std::to_string(width);
+    } else if (line.rfind("samples_per_pixel", 0) == 0) {
+      line = "samples_per_pixel = " + std::to_string(samples);
+    } else if (line.rfind("wavefront", 0) == 0) {
+      line = std::string("wavefront = ") + toml_bool(integrator.wavefront);
+    } else if (line.rfind("sort_rays", 0) == 0) {
+      line = std::string("sort_rays = ") + toml_bool(integrator.sort_rays);
+    }
+    text << line << "\n";
+  }
+  return text.str();
+}
+
+// Parameters of a material of type with albedo and parameter
+material_desc make_material(material_kind type, const color &albedo,
+                            double parameter = 0) {
+  material_desc desc;
+  desc.type = type;
+  desc.albedo[0] = albedo.x();
+  desc.albedo[1] = albedo.y();
+  desc.albedo[2] = albedo.z();
+  desc.parameter = parameter;
+  return desc;
+}
+
+// Add a sphere with a new material to the scene parameters
+void add_sphere(scene_desc &desc, const point3 &center, double radius,
+                const material_desc &mat) {
+  sphere_desc s{};
+  s.center[0] = center.x();
+  s.center[1] = center.y();
+  s.center[2] = center.z();
+  s.radius = radius;
+  s.material = uint32_t(desc.materials.size());
+  desc.materials.push_back(mat);
+  desc.spheres.push_back(s);
+}
+
+// Create the spheres of the scene parameters, like the scene loader does
+void build_scene(const scene_desc &desc, scene &world) {
+  build_scene(desc.materials.data(), desc.materials.size(),
+              desc.spheres.data(), desc.spheres.size(), world);
+}
+
+// A ground sphere and count small spheres scattered on it, mostly diffuse with
+// some metal and glass, like the cover of the book
+void build_random_spheres(scene &world, int count) {
+  seed_random(1);
+  scene_desc desc;
+  add_sphere(desc, point3(0, -1000, 0), 1000,
+             make_material(material_kind::lambertian, color(0.5, 0.5, 0.5)));
+
+  // Side of the square the spheres are placed on, about one per unit area
+  const double side = std::sqrt(double(count));
+  for (int n = 0; n < count; n++) {
+    const point3 center(random_double(-side / 2, side / 2), 0.2,
+                        random_double(-side / 2, side / 2));
+    const double choose_material = random_double();
+
+    if (choose_material < 0.7) {
+      add_sphere(desc, center, 0.2,
+                 make_material(material_kind::lambertian,
+                               color::random() * color::random()));
+    } else if (choose_material < 0.9) {
+      add_sphere(desc, center, 0.2,
+                 make_material(material_kind::metal, color::random(0.5, 1),
+                               random_double(0, 0.5)));
+    } else {
+      add_sphere(desc, center, 0.2,
+                 make_material(material_kind::dielectric, color(), 1.5));
+    }
+  }
+  build_scene(desc, world);
+}
+
+// Glass spheres, half of them hollow, in front of a few diffuse ones, so most
+// paths refract many times before they leave
+void build_dielectric_spheres(scene &world) {
+  seed_random(2);
+  scene_desc desc;
+  add_sphere(desc, point3(0, -1000, 0), 1000,
+             make_material(material_kind::lambertian, color(0.5, 0.5, 0.5)));
+
+  for (int a = -6; a < 6; a++) {
+    for (int b = -6; b < 6; b++) {
+      const point3 center(a + 0.9 * random_double(), 0.4,
+                          b + 0.9 * random_double());
+      if ((a + b) % 3 == 0) {
+        add_sphere(desc, center, 0.4,
+                   make_material(material_kind::lambertian, color::random()));
+        continue;
+      }
+      add_sphere(desc, center, 0.4,
+                 make_material(material_kind::dielectric, color(), 1.5));
+      if ((a + b) % 2 == 0) {
+        // Air bubble inside the glass
+        add_sphere(desc, center, 0.3,
+                   make_material(material_kind::dielectric, color(),
+                                 1.0 / 1.5));
+      }
+    }
+  }
+  build_scene(desc, world);
+}
+
+// Render one scene and print its result as a JSON object
+bool run_scene(const reference_scene &reference, std::ostream &json) {
+  std::clog << "Scene: " << reference.name << "\n";
+
+  toml::table config;
+  try {
+    config = toml::parse(reference.camera_config);
+  } catch (toml::parse_error &err) {
+    std::cerr << "Error: Invalid config of scene " << reference.name << "\n";
+    std::cerr << err << "\n";
+    return false;
+  }
+
+  // Build the scene and its bounding volume hierarchy
+  const auto build_start = std::chrono::steady_clock::now();
+  scene world;
+  if (!reference.build(world)) {
+    return false;
+  }
+  const size_t object_count = world.objects.objects.size();
+  const hittable &world_bvh = build_bvh(world);
+  const double build_seconds = seconds_since(build_start);
+
+  // Render without writing the image
+  camera cam(config);
+  cam.set_lights(&world.lights);
+  render_stats stats;
+  cam.render_multithread(world_bvh, &stats);
+
+  json << std::setprecision(6);
+  json << "    {\n"
+       << "      \"name\": \"" << reference.name << "\",\n"
+       << "      \"objects\": " << object_count << ",\n"
+       << "      \"width\": " << cam.width() << ",\n"
+       << "      \"height\": " << cam.height() << ",\n"
+       << "      \"samples\": " << stats.samples << ",\n"
+       << "      \"rays\": " << stats.rays << ",\n"
+       << "      \"build_seconds\": " << build_seconds << ",\n"
+       << "      \"scene_bytes\": " << world.memory.bytes_used() << ",\n"
+       << "      \"render_seconds\": " << stats.seconds << ",\n"
+       << "      \"first_tile_seconds\": " << stats.first_tile_seconds
+       << ",\n"
+       << "      \"rays_per_second\": " << stats.rays / stats.seconds << ",\n"
+       << "      \"samples_per_second\": " << stats.samples / stats.seconds
+       << ",\n"
+       << "      \"peak_memory_bytes\": " << peak_memory_bytes() << "\n"
+       << "    }";
+
+  std::clog << "Rays per second: " << stats.rays / stats.seconds << "\n\n";
+  return true;
+}
+
+// Render one scene in a child process and print its result as a JSON object,
+// the peak memory of the process would otherwise include earlier scenes
+bool run_scene_process(const reference_scene &reference, std::ostream &json) {
+#ifdef BENCHMARK_FORK
+  int result_pipe[2];
+  if (pipe(result_pipe) != 0) {
+    std::cerr << "Error: Cannot create a pipe: " << std::strerror(errno)
+              << "\n";
+    return false;
+  }
+
+  // Buffered output would be written by both processes
+  std::cout.flush();
+  std::clog.flush();
+  const pid_t child = fork();
+  if (child < 0) {
+    std::cerr << "Error: Cannot fork: " << std::strerror(errno) << "\n";
+    close(result_pipe[0]);
+    close(result_pipe[1]);
+    return false;
+  }
+
+  if (child == 0) {
+    // Child: render and send the JSON object to the parent
+    close(result_pipe[0]);
+    std::ostringstream result;
+    bool rendered = run_scene(reference, result);
+    const std::string text = result.str();
+    size_t written = 0;
+    while (rendered && written < text.size()) {
+      const ssize_t count =
+          write(result_pipe[1], text.data() + written, text.size() - written);
+      if (count < 0 && errno == EINTR) {
+        continue;
+      }
+      rendered = count > 0;
+      written += rendered ? size_t(count) : 0;
+    }
+    close(result_pipe[1]);
+    std::clog.flush();
+    std::cerr.flush();
+    _exit(rendered ? 0 : 1);
+  }
+
+  // Parent: read the JSON object until the child closes the pipe
+  close(result_pipe[1]);
+  std::string text;
+  char buffer[4096];
+  while (true) {
+    const ssize_t count = read(result_pipe[0], buffer, sizeof(buffer));
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    text.append(buffer, size_t(count));
+  }
+  close(result_pipe[0]);
+
+  int status = 0;
+  while (waitpid(child, &status, 0) < 0 && errno == EINTR) {
+  }
+  if (WIFSIGNALED(status)) {
+    std::cerr << "Error: Scene " << reference.name << " died of signal "
+              << WTERMSIG(status) << "\n";
+    return false;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return false;
+  }
+  json << text;
+  return true;
+#else
+  return run_scene(reference, json);
+#endif
+}
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+  // Init argparse
+  argparse::ArgumentParser program("ray-tracing-benchmark");
+  // Add argument "--working-directory", containing config_template.toml
+  program.add_argument("--working-directory")
+      .help("Path to the directory containing config_template.toml")
+      .default_value(std::string("."))
+      .append();
+  // Add argument "--json", the file the results are written to
+  program.add_argument("--json")
+      .help("Write the results to this file instead of stdout");
+  // Add argument "--width", image width of every scene
+  program.add_argument("--width")
+      .help("Image width of every scene")
+      .default_value(640)
+      .scan<'i', int>();
+  // Add argument "--samples", samples per pixel of every scene
+  program.add_argument("--samples")
+      .help("Samples per pixel of every scene")
+      .default_value(16)
+      .scan<'i', int>();
+  // Add argument "--wavefront", render every scene with the wavefront
+  // integrator
+  program.add_argument("--wavefront")
+      .help("Trace the samples of every tile in wavefront batches")
+      .default_value(false)
+      .implicit_value(true);
+  // Add argument "--sort-rays", reorder the rays of every wavefront bounce
+  program.add_argument("--sort-rays")
+      .help("Reorder scattered rays by origin and direction, implies "
+            "--wavefront")
+      .default_value(false)
+      .implicit_value(true);
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  const auto workdir = program.get<std::string>("--working-directory");
+  const auto width = program.get<int>("--width");
+  const auto samples = program.get<int>("--samples");
+  if (width <= 0 || samples <= 0) {
+    std::cerr << "Error: --width and --samples must be positive.\n";
+    return 1;
+  }
+  integrator_options integrator;
+  integrator.sort_rays = program.get<bool>("--sort-rays");
+  integrator.wavefront =
+      integrator.sort_rays || program.get<bool>("--wavefront");
+
+  // The scene of config_template.toml, loaded like the renderer does
+  const auto template_path = workdir + "/config_template.toml";
+  const auto template_text =
+      template_config(template_path, width, samples, integrator);
+  if (template_text.empty()) {
+    std::cerr << "Error: Cannot read " << template_path << "\n";
+    return 1;
+  }
+
+  // Camera of the random sphere scenes, looking over the ground
+  const auto random_camera = [&](int count) -> std::string {
+    const double side = std::sqrt(double(count));
+    return camera_config(width, samples, point3(side / 2, 2, side / 2),
+                         point3(0, 0, 0), 60.0, integrator);
+  };
+
+  const std::vector<reference_scene> scenes = {
+      {"template", template_text,
+       [&](scene &world) -> bool {
+         toml::table config;
+         try {
+           config = toml::parse(template_text);
+         } catch (toml::parse_error &err) {
+           std::cerr << "Error loading config_template.toml: " << template_path
+                     << "\n";
+           std::cerr << err << "\n";
+           return false;
+         }
+         return load_scene(config, world, workdir);
+       }},
+      {"spheres-500", random_camera(500),
+       [](scene &world) -> bool {
+         build_random_spheres(world, 500);
+         return true;
+       }},
+      {"spheres-10k", random_camera(10000),
+       [](scene &world) -> bool {
+         build_random_spheres(world, 10000);
+         return true;
+       }},
+      {"spheres-100k", random_camera(100000),
+       [](scene &world) -> bool {
+         build_random_spheres(world, 100000);
+         return true;
+       }},
+      {"dielectric",
+       camera_config(width, samples, point3(8, 3, 8), point3(0, 0, 0), 45.0,
+                     integrator),
+       [](scene &world) -> bool {
+         build_dielectric_spheres(world);
+         return true;
+       }},
+  };
+
+  // Results as JSON, written once every scene has been rendered
+  std::ostringstream json;
+  json << "{\n"
+       << "  \"threads\": " << std::thread::hardware_concurrency() << ",\n"
+       << "  \"wavefront\": " << toml_bool(integrator.wavefront) << ",\n"
+       << "  \"sort_rays\": " << toml_bool(integrator.sort_rays) << ",\n"
+       << "  \"scenes\": [\n";
+  for (size_t n = 0; n < scenes.size(); n++) {
+    if (!run_scene_process(scenes[n], json)) {
+      return 1;
+    }
+    json << (n + 1 < scenes.size() ? ",\n" : "\n");
+  }
+  json << "  ]\n"
+       << "}\n";
+
+  if (!program.is_used("--json")) {
+    std::cout << json.str();
+    return 0;
+  }
+  const auto json_path = program.get<std::string>("--json");
+  std::ofstream json_file(json_path);
+  if (!json_file) {
+    std::cerr << "Error: Cannot open output file: " << json_path << "\n";
+    return 1;
+  }
+  json_file << json.str();
+  return 0;
+}
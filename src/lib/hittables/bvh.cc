@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <vector>
+
+#include "hittables/bvh.h"
+#include "hittables/sah.h"
+#include "hittables/sphere.h"
+#include "hittables/sphere_soup.h"
+#include "utils/counters.h"
+#include "utils/rtweekend.h"
+
+// Group objects[start, end) into one sphere soup in nodes, or nullptr if any
+// of them is not a sphere
+static sphere_soup *make_sphere_soup(arena &nodes,
+                                     const std::vector<hittable *> &objects,
+                                     size_t start, size_t end) {
+  for (size_t i = start; i < end; i++) {
+    if (dynamic_cast<const sphere *>(objects[i]) == nullptr) {
+      return nullptr;
+    }
+  }
+  auto soup = nodes.create<sphere_soup>();
+  for (size_t i = start; i < end; i++) {
+    soup->add(*static_cast<const sphere *>(objects[i]));
+  }
+  return soup;
+}
+
+// Build the hierarchy from all objects of the list
+bvh_node::bvh_node(arena &nodes, hittable_list list)
+    : bvh_node(nodes, list.objects, 0, list.objects.size()) {}
+
+// Build the hierarchy from objects[start, end), reordering them
+bvh_node::bvh_node(arena &nodes, std::vector<hittable *> &objects,
+                   size_t start, size_t end)
+    : split_axis(0) {
+  // Box of all objects, and box of their centroids which drives the split
+  aabb centroid_box;
+  for (size_t i = start; i < end; i++) {
+    const aabb object_box = objects[i]->bounding_box();
+    bbox = aabb(bbox, object_box);
+    const point3 c = object_box.centroid();
+    centroid_box = aabb(centroid_box, aabb(c, c));
+  }
+
+  const size_t object_span = end - start;
+
+  // Empty world, a node without children that nothing hits
+  if (object_span == 0) {
+    return;
+  }
+
+  // Leaf with one object
+  if (object_span == 1) {
+    left = objects[start];
+    return;
+  }
+
+  // Few spheres left, test them together with SIMD instead of splitting
+  if (object_span <= sphere_soup::max_leaf_size) {
+    if (const auto soup = make_sphere_soup(nodes, objects, start, end)) {
+      left = soup;
+      return;
+    }
+  }
+
+  // Two objects, no need to evaluate any split
+  if (object_span == 2) {
+    split_axis = centroid_box.longest_axis();
+    const auto centroid_of = [this](const hittable *object) {
+      return object->bounding_box().centroid()[split_axis];
+    };
+    left = objects[start];
+    right = objects[start + 1];
+    if (centroid_of(right) < centroid_of(left)) {
+      std::swap(left, right);
+    }
+    return;
+  }
+
+  const auto box_of = [](const hittable *object) {
+    return object->bounding_box();
+  };
+  size_t mid = sah_partition(objects.begin() + start, objects.begin() + end,
+                             centroid_box, box_of, split_axis) -
+               objects.begin();
+
+  // All centroids coincide or no split is cheaper than any other, fall back to
+  // a median split along the longest axis
+  if (mid == start || mid == end) {
+    split_axis = centroid_box.longest_axis();
+    mid = start + object_span / 2;
+    std::nth_element(objects.begin() + start, objects.begin() + mid,
+                     objects.begin() + end,
+                     [this](const hittable *a, const hittable *b) {
+                       return a->bounding_box().centroid()[split_axis] <
+                              b->bounding_box().centroid()[split_axis];
+                     });
+  }
+
+  left = nodes.create<bvh_node>(nodes, objects, start, mid);
+  right = nodes.create<bvh_node>(nodes, objects, mid, end);
+}
+
+// Determine if the ray hits any object in the hierarchy, nearest first
+bool bvh_node::hit(const ray &r, interval ray_t, hit_record &record) const {
+  count_bvh_node();
+  if (!left || !bbox.hit(r, ray_t)) {
+    return false;
+  }
+
+  // Single-object leaf
+  if (!right) {
+    return left->hit(r, ray_t, record);
+  }
+
+  // Visit the child nearer to the ray origin first, so a hit there shrinks the
+  // interval and lets the farther child be culled by its box
+  const bool reversed = r.direction()[split_axis] < 0;
+  const hittable &first = reversed ? *right : *left;
+  const hittable &second = reversed ? *left : *right;
+
+  const bool hit_first = first.hit(r, ray_t, record);
+  const bool hit_second = second.hit(
+      r, interval(ray_t.min, hit_first ? record.t : ray_t.max), record);
+
+  return hit_first || hit_second;
+}
+
+// Determine if the ray hits any object in the hierarchy, in any order
+bool bvh_node::occluded(const ray &r, interval ray_t) const {
+  count_bvh_node();
+  if (!left || !bbox.hit(r, ray_t)) {
+    return false;
+  }
+
+  // Any hit will do, so the children are visited in a fixed order and the
+  // second one only if the first is not hit
+  return left->occluded(r, ray_t) || (right && right->occluded(r, ray_t));
+}
+
+aabb bvh_node::bounding_box() const { return bbox; }
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hittables/flat_bvh.h"
+#include "hittables/sah.h"
+
+// Build the hierarchy over the boxes of the primitives
+std::vector<uint32_t> flat_bvh::build(const std::vector<aabb> &boxes,
+                                      size_t max_leaf_size) {
+  std::vector<uint32_t> order(boxes.size());
+  for (size_t k = 0; k < order.size(); k++) {
+    order[k] = uint32_t(k);
+  }
+
+  nodes.clear();
+  if (boxes.empty()) {
+    return order;
+  }
+
+  // About two nodes per leaf
+  nodes.reserve(2 * boxes.size() / max_leaf_size + 1);
+  build(order, boxes, max_leaf_size, 0, order.size(), 0);
+  return order;
+}
+
+// Build the subtree over order[start, end)
+uint32_t flat_bvh::build(std::vector<uint32_t> &order,
+                         const std::vector<aabb> &boxes, size_t max_leaf_size,
+                         size_t start, size_t end, int depth) {
+  const uint32_t index = uint32_t(nodes.size());
+  nodes.push_back(entry{aabb(), uint32_t(start), 0, 0});
+
+  // Box of all primitives, and box of their centroids which drives the split
+  aabb box, centroid_box;
+  for (size_t i = start; i < end; i++) {
+    box = aabb(box, boxes[order[i]]);
+    const point3 c = boxes[order[i]].centroid();
+    centroid_box = aabb(centroid_box, aabb(c, c));
+  }
+  nodes[index].box = box;
+
+  const size_t span = end - start;
+  if (span <= max_leaf_size) {
+    nodes[index].count = uint16_t(span);
+    return index;
+  }
+
+  // Binned surface area heuristic; deep trees fall back to median splits,
+  // bounding the traversal stack
+  const auto box_of = [&](uint32_t k) -> const aabb & { return boxes[k]; };
+  int axis = 0;
+  size_t mid = start;
+  if (depth < max_sah_depth) {
+    mid = sah_partition(order.begin() + start, order.begin() + end,
+                        centroid_box, box_of, axis) -
+          order.begin();
+  }
+  if (mid == start) {
+    // All centroids coincide or the tree is deep, split in the middle
+    axis = centroid_box.longest_axis();
+    mid = start + span / 2;
+    std::nth_element(order.begin() + start, order.begin() + mid,
+                     order.begin() + end, [&](uint32_t a, uint32_t b) {
+                       return boxes[a].centroid()[axis] <
+                              boxes[b].centroid()[axis];
+                     });
+  }
+
+  nodes[index].axis = uint16_t(axis);
+  build(order, boxes, max_leaf_size, start, mid, depth + 1);
+  nodes[index].offset =
+      build(order, boxes, max_leaf_size, mid, end, depth + 1);
+  return index;
+}
@@ -1,13 +1,15 @@
-#include <memory>
-
 #include "hittables/hittable_list.h"
 
-hittable_list::hittable_list(std::shared_ptr<hittable> object) { add(object); }
+hittable_list::hittable_list(hittable *object) { add(object); }
 
 // Clear list
-void hittable_list::clear() { objects.clear(); }
-// Add an object to the list
-void hittable_list::add(std::shared_ptr<hittable> object) {
+void hittable_list::clear() {
+  objects.clear();
+  bbox = aabb();
+}
+// Add an object to the list, growing the bounding box to enclose it
+void hittable_list::add(hittable *object) {
+  bbox = aabb(bbox, object->bounding_box());
   objects.push_back(object);
 }
 
@@ -19,18 +21,29 @@ bool hittable_list::hit(const ray &r, interval ray_t,
   auto closest_t_so_far = ray_t.max;
 
   for (const auto &object : objects) {
-    // Create temporary hit_record
-    hit_record temp_record;
     // If the object not hit, skip
-    if (!object->hit(r, interval(ray_t.min, closest_t_so_far), temp_record)) {
+    // Objects only write the record on a hit, and the shrinking interval
+    // makes every later hit nearer, so the record can be filled in place
+    if (!object->hit(r, interval(ray_t.min, closest_t_so_far), record)) {
       continue;
     }
     // Hit, update the closest t
     hit_anything = true;
-    closest_t_so_far = temp_record.t;
-    record = temp_record;
+    closest_t_so_far = record.t;
   }
 
   // Return true if any object is hit
   return hit_anything;
-}
\ No newline at end of file
+}
+
+// Determine if the ray hits any object in the list, stopping at the first
+bool hittable_list::occluded(const ray &r, interval ray_t) const {
+  for (const auto &object : objects) {
+    if (object->occluded(r, ray_t)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+aabb hittable_list::bounding_box() const { return bbox; }
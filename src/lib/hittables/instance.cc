@@ -0,0 +1,33 @@
+#include "hittables/hittable.h"
+#include "hittables/instance.h"
+#include "utils/transform.h"
+
+instance::instance(const hittable *object,
+                   const affine_transform &object_to_world)
+    : object(object), object_to_world(object_to_world),
+      world_to_object(object_to_world.inverse()),
+      bbox(object_to_world.apply_box(object->bounding_box())) {}
+
+// Determine if the ray hits the object
+bool instance::hit(const ray &r, interval ray_t, hit_record &record) const {
+  // The direction is not normalized, so t is the same in both spaces
+  const ray object_ray(world_to_object.apply_point(r.origin()),
+                       world_to_object.apply_vector(r.direction()), r.time());
+  if (!object->hit(object_ray, ray_t, record)) {
+    return false;
+  }
+
+  // The normal keeps facing against the ray, so front_face stays valid
+  record.point = object_to_world.apply_point(record.point);
+  record.normal = unit_vector(world_to_object.apply_transposed(record.normal));
+  return true;
+}
+
+// Determine if the ray hits the object, in object space
+bool instance::occluded(const ray &r, interval ray_t) const {
+  const ray object_ray(world_to_object.apply_point(r.origin()),
+                       world_to_object.apply_vector(r.direction()), r.time());
+  return object->occluded(object_ray, ray_t);
+}
+
+aabb instance::bounding_box() const { return bbox; }
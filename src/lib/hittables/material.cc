@@ -1,18 +1,13 @@
+#include <cmath>
+#include <variant>
+
 #include "hittables/material.h"
+#include "utils/counters.h"
 #include "utils/interval.h"
 #include "utils/ray.h"
 #include "utils/rtweekend.h"
 #include "utils/vec3.h"
 
-// Set destructor to default
-material::~material() = default;
-
-// Set scatter to default
-bool material::scatter(const ray &r_in, const hit_record &rec,
-                       color &attenuation, ray &scattered) const {
-  return false;
-}
-
 // Lambertian material
 
 // Constructor, using color as albedo
@@ -21,6 +16,8 @@ lambertian::lambertian(const color &albedo) : albedo(albedo) {}
 // Scatter function
 bool lambertian::scatter(const ray &r_in, const hit_record &rec,
                          color &attenuation, ray &scattered) const {
+  count_scatter(material_kind::lambertian);
+
   // Lambertian scatter
   auto scatter_direction = rec.normal + random_unit_vector();
   // Catch degenerate scatter direction
@@ -31,28 +28,45 @@ bool lambertian::scatter(const ray &r_in, const hit_record &rec,
   }
 
   // Set the scatter direction
-  scattered = ray(rec.point, scatter_direction);
+  scattered = ray(offset_ray_origin(rec.point, rec.normal, scatter_direction),
+                  scatter_direction, r_in.time());
   // Set the attenuation properties
   attenuation = albedo;
 
   return true;
 }
 
+// Lambertian BSDF albedo / pi, times the cosine
+color lambertian::bsdf_cosine(const hit_record &rec,
+                              const vec3 &direction) const {
+  return scattering_pdf(rec, direction) * albedo;
+}
+
+// scatter picks normal + random unit vector, which is cosine distributed
+real lambertian::scattering_pdf(const hit_record &rec,
+                                const vec3 &direction) const {
+  return std::fmax(real(0), dot(rec.normal, direction)) / pi;
+}
+
 // Metal material
 
 // Constructor, using color as albedo, and fuzziness
-metal::metal(const color &albedo, const double fuzz)
+metal::metal(const color &albedo, const real fuzz)
     : albedo(albedo), fuzz(interval(0.0, 1.0).clamp(fuzz)) {}
 
 // Scatter function
 bool metal::scatter(const ray &r_in, const hit_record &rec, color &attenuation,
                     ray &scattered) const {
+  count_scatter(material_kind::metal);
+
   // Metal scatter
   vec3 reflected_direction = reflect(r_in.direction(), rec.normal);
   // Add fuzziness to the reflected direction
   reflected_direction =
       unit_vector(reflected_direction) + (fuzz * random_unit_vector());
-  scattered = ray(rec.point, reflected_direction);
+  scattered =
+      ray(offset_ray_origin(rec.point, rec.normal, reflected_direction),
+          reflected_direction, r_in.time());
   attenuation = albedo;
   // Check if the scattered ray is in the same hemisphere as the normal
   return (dot(scattered.direction(), rec.normal) > 0);
@@ -61,11 +75,11 @@ bool metal::scatter(const ray &r_in, const hit_record &rec, color &attenuation,
 // Dielectric material
 
 // Constructor, using refractive index
-dielectric::dielectric(double refractive_index)
+dielectric::dielectric(real refractive_index)
     : refractive_index(refractive_index) {}
 
 // Schlick approximation for reflectance
-double dielectric::reflectance(double cosine, double refraction_index) {
+real dielectric::reflectance(real cosine, real refraction_index) {
   auto r0 = (1 - refraction_index) / (1 + refraction_index);
   r0 = r0 * r0;
   return r0 + (1 - r0) * std::pow((1 - cosine), 5);
@@ -74,18 +88,20 @@ double dielectric::reflectance(double cosine, double refraction_index) {
 // Scatter function
 bool dielectric::scatter(const ray &r_in, const hit_record &rec,
                          color &attenuation, ray &scattered) const {
+  count_scatter(material_kind::dielectric);
+
   // Default attenuation color is white (or transparent)
   attenuation = color(1.0, 1.0, 1.0);
 
   // Calculate the refractive index ratio (n1/n2)
-  const double ri =
-      rec.front_face ? (1.0 / refractive_index) : refractive_index;
+  const real ri =
+      rec.front_face ? (real(1) / refractive_index) : refractive_index;
   // UV vector
   const vec3 unit_direction = unit_vector(r_in.direction());
 
   // Check if total internal reflection occurs
-  const double cos_theta = fmin(dot(-unit_direction, rec.normal), 1.0);
-  const double sin_theta_squared = 1.0 - cos_theta * cos_theta;
+  const real cos_theta = std::fmin(dot(-unit_direction, rec.normal), real(1));
+  const real sin_theta_squared = real(1) - cos_theta * cos_theta;
 
   // If ri * sin_theta > 1.0 (ri^2 * sin_theta^2 > 1.0),
   // total internal reflection occurs
@@ -93,12 +109,84 @@ bool dielectric::scatter(const ray &r_in, const hit_record &rec,
       reflectance(cos_theta, ri) > random_double()) {
     // Reflect the ray
     const vec3 reflected_direction = reflect(unit_direction, rec.normal);
-    scattered = ray(rec.point, reflected_direction);
+    scattered =
+        ray(offset_ray_origin(rec.point, rec.normal, reflected_direction),
+            reflected_direction, r_in.time());
     return true;
   }
 
   // Otherwise, calculate the refracted direction
   const vec3 refracted_direction = refract(unit_direction, rec.normal, ri);
-  scattered = ray(rec.point, refracted_direction);
+  scattered =
+      ray(offset_ray_origin(rec.point, rec.normal, refracted_direction),
+          refracted_direction, r_in.time());
   return true;
-}
\ No newline at end of file
+}
+
+// Diffuse light
+
+// Constructor, using the emitted radiance
+diffuse_light::diffuse_light(const color &emission) : emission(emission) {}
+
+// Only the front face emits, so closed lights do not light their inside
+color diffuse_light::emitted(const hit_record &rec) const {
+  return rec.front_face ? emission : color(0, 0, 0);
+}
+
+// Material
+// NOTE: kind() already tells the alternative, so it is read with get_if
+// rather than std::get, which would check the index again and may throw
+
+material::material(const lambertian &m) : value(m) {}
+material::material(const metal &m) : value(m) {}
+material::material(const dielectric &m) : value(m) {}
+material::material(const diffuse_light &m) : value(m) {}
+
+// Scatter by the concrete material, lights absorb every ray
+bool material::scatter(const ray &r_in, const hit_record &rec,
+                       color &attenuation, ray &scattered) const {
+  switch (kind()) {
+  case material_kind::lambertian:
+    return std::get_if<lambertian>(&value)->scatter(r_in, rec, attenuation,
+                                                    scattered);
+  case material_kind::metal:
+    return std::get_if<metal>(&value)->scatter(r_in, rec, attenuation,
+                                               scattered);
+  case material_kind::dielectric:
+    return std::get_if<dielectric>(&value)->scatter(r_in, rec, attenuation,
+                                                    scattered);
+  case material_kind::light:
+  case material_kind::count:
+    break;
+  }
+  return false;
+}
+
+// Only lights emit
+color material::emitted(const hit_record &rec) const {
+  if (kind() == material_kind::light) {
+    return std::get_if<diffuse_light>(&value)->emitted(rec);
+  }
+  return color(0, 0, 0);
+}
+
+// Only lambertian scattering spreads over the hemisphere
+bool material::is_specular() const {
+  return kind() != material_kind::lambertian;
+}
+
+color material::bsdf_cosine(const hit_record &rec,
+                            const vec3 &direction) const {
+  if (kind() == material_kind::lambertian) {
+    return std::get_if<lambertian>(&value)->bsdf_cosine(rec, direction);
+  }
+  return color(0, 0, 0);
+}
+
+real material::scattering_pdf(const hit_record &rec,
+                              const vec3 &direction) const {
+  if (kind() == material_kind::lambertian) {
+    return std::get_if<lambertian>(&value)->scattering_pdf(rec, direction);
+  }
+  return 0;
+}
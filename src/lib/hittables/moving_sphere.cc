@@ -0,0 +1,34 @@
+#include <algorithm>
+
+#include "hittables/hittable.h"
+#include "hittables/moving_sphere.h"
+#include "hittables/sphere.h"
+#include "utils/counters.h"
+
+moving_sphere::moving_sphere(const point3 &center0, const point3 &center1,
+                             const real radius, const material *mat)
+    : center0(center0), motion(center1 - center0),
+      radius(std::max(real(0), radius)), mat(mat) {
+  // Boxes of the sphere at both ends of its motion enclose the whole sweep
+  const vec3 radius_vector(this->radius, this->radius, this->radius);
+  const aabb box0(center0 - radius_vector, center0 + radius_vector);
+  const aabb box1(center1 - radius_vector, center1 + radius_vector);
+  bbox = aabb(box0, box1);
+}
+
+// Determine if the ray hits the sphere at the time of the ray
+bool moving_sphere::hit(const ray &r, interval ray_t,
+                        hit_record &record) const {
+  count_object_tests(1);
+  return hit_sphere(center_at(r.time()), radius, mat, r, ray_t, record);
+}
+
+// Determine if the ray hits the sphere at the time of the ray, without
+// filling a record
+bool moving_sphere::occluded(const ray &r, interval ray_t) const {
+  count_object_tests(1);
+  real t;
+  return intersect_sphere(center_at(r.time()), radius, r, ray_t, t);
+}
+
+aabb moving_sphere::bounding_box() const { return bbox; }
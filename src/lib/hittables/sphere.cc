@@ -1,14 +1,20 @@
-#include <memory>
+#include <algorithm>
 
 #include "hittables/hittable.h"
 #include "hittables/sphere.h"
+#include "utils/counters.h"
 
-sphere::sphere(const point3 &center, const double radius,
-               std::shared_ptr<material> mat)
-    : center(center), radius(std::max(0.0, radius)), mat(mat) {}
+sphere::sphere(const point3 &center, const real radius,
+               const material *mat)
+    : center(center), radius(std::max(real(0), radius)), mat(mat) {
+  // Box from the corners of the cube enclosing the sphere
+  const vec3 radius_vector(this->radius, this->radius, this->radius);
+  bbox = aabb(center - radius_vector, center + radius_vector);
+}
 
-// Determine if the ray hits the sphere
-bool sphere::hit(const ray &r, interval ray_t, hit_record &record) const {
+// Parameter t of the nearest hit of the ray on the sphere within ray_t
+bool intersect_sphere(const point3 &center, real radius, const ray &r,
+                      interval ray_t, real &t) {
   // t^2⋅d⋅d−2t⋅d⋅(C−Q)+(C−Q)⋅(C−Q)−r^2=0
   // a = d⋅d
   // b = -2⋅d⋅(C−Q); h = d⋅(C−Q)
@@ -44,6 +50,18 @@ bool sphere::hit(const ray &r, interval ray_t, hit_record &record) const {
     // Otherwise we have a hit
   }
 
+  t = root;
+  return true;
+}
+
+// Determine if the ray hits the sphere of center and radius
+bool hit_sphere(const point3 &center, real radius, const material *mat,
+                const ray &r, interval ray_t, hit_record &record) {
+  real root;
+  if (!intersect_sphere(center, radius, r, ray_t, root)) {
+    return false;
+  }
+
   // Then fill the hit record
   record.t = root;
   record.point = r.at(record.t);
@@ -52,4 +70,19 @@ bool sphere::hit(const ray &r, interval ray_t, hit_record &record) const {
   record.mat = mat;
 
   return true;
-}
\ No newline at end of file
+}
+
+// Determine if the ray hits the sphere
+bool sphere::hit(const ray &r, interval ray_t, hit_record &record) const {
+  count_object_tests(1);
+  return hit_sphere(center, radius, mat, r, ray_t, record);
+}
+
+// Determine if the ray hits the sphere, without filling a record
+bool sphere::occluded(const ray &r, interval ray_t) const {
+  count_object_tests(1);
+  real t;
+  return intersect_sphere(center, radius, r, ray_t, t);
+}
+
+aabb sphere::bounding_box() const { return bbox; }
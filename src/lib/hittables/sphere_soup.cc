@@ -0,0 +1,557 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include "hittables/sphere_soup.h"
+#include "utils/counters.h"
+
+// SIMD kernels are only built for x86 with GCC or Clang, which can compile a
+// single function for an instruction set the rest of the program may not use
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define SPHERE_SOUP_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define SPHERE_SOUP_X86_SIMD 0
+#endif
+
+namespace {
+
+// Read-only view of the sphere arrays handed to the kernels
+struct sphere_arrays {
+  const double *center_x, *center_y, *center_z, *radius;
+  size_t count;
+};
+
+// Nearest sphere hit by the ray with t in (t_min, closest), returns its index
+// or -1, and shrinks closest to its t
+using nearest_kernel = long (*)(const sphere_arrays &spheres, const ray &r,
+                                double t_min, double &closest);
+
+// Nearest sphere of every ray of a packet of up to max_packet_size rays,
+// closest[k] and nearest[k] work as in nearest_kernel for rays[k]
+using packet_kernel = void (*)(const sphere_arrays &spheres, const ray *rays,
+                               size_t count, double t_min, double *closest,
+                               long *nearest);
+
+long nearest_scalar(const sphere_arrays &spheres, const ray &r, double t_min,
+                    double &closest) {
+  // Same equation as sphere::hit
+  const point3 &origin = r.origin();
+  const vec3 &direction = r.direction();
+  const double a = direction.length_squared();
+
+  long nearest = -1;
+  for (size_t k = 0; k < spheres.count; k++) {
+    const double cx = spheres.center_x[k] - origin.x();
+    const double cy = spheres.center_y[k] - origin.y();
+    const double cz = spheres.center_z[k] - origin.z();
+
+    const double h = direction.x() * cx + direction.y() * cy +
+                     direction.z() * cz;
+    const double c =
+        cx * cx + cy * cy + cz * cz - spheres.radius[k] * spheres.radius[k];
+    const double discriminant = h * h - a * c;
+    if (discriminant < 0) {
+      continue;
+    }
+
+    // Nearer root first, then the farther one
+    const double sqrt_discriminant = std::sqrt(discriminant);
+    double root = (h - sqrt_discriminant) / a;
+    if (!(t_min < root && root < closest)) {
+      root = (h + sqrt_discriminant) / a;
+      if (!(t_min < root && root < closest)) {
+        continue;
+      }
+    }
+
+    closest = root;
+    nearest = long(k);
+  }
+  return nearest;
+}
+
+void packet_scalar(const sphere_arrays &spheres, const ray *rays,
+                   size_t count, double t_min, double *closest,
+                   long *nearest) {
+  for (size_t k = 0; k < count; k++) {
+    nearest[k] = nearest_scalar(spheres, rays[k], t_min, closest[k]);
+  }
+}
+
+#if SPHERE_SOUP_X86_SIMD
+
+// One ray against 4 spheres per iteration, a full soup in two
+__attribute__((target("avx2,fma"))) long
+nearest_avx2(const sphere_arrays &spheres, const ray &r, double t_min,
+             double &closest) {
+  const point3 &origin = r.origin();
+  const vec3 &direction = r.direction();
+
+  const __m256d ox = _mm256_set1_pd(origin.x());
+  const __m256d oy = _mm256_set1_pd(origin.y());
+  const __m256d oz = _mm256_set1_pd(origin.z());
+  const __m256d dx = _mm256_set1_pd(direction.x());
+  const __m256d dy = _mm256_set1_pd(direction.y());
+  const __m256d dz = _mm256_set1_pd(direction.z());
+  const __m256d a = _mm256_set1_pd(direction.length_squared());
+  const __m256d t_minimum = _mm256_set1_pd(t_min);
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d sphere_count = _mm256_set1_pd(double(spheres.count));
+
+  // Nearest t and sphere index found by every lane
+  __m256d best_t = _mm256_set1_pd(closest);
+  __m256d best_k = _mm256_set1_pd(-1.0);
+  __m256d lane_k = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+  const __m256d step = _mm256_set1_pd(4.0);
+
+  for (size_t k = 0; k < spheres.count;
+       k += 4, lane_k = _mm256_add_pd(lane_k, step)) {
+    // Lanes past the last sphere load nothing and never hit
+    const __m256d active = _mm256_cmp_pd(lane_k, sphere_count, _CMP_LT_OQ);
+    const __m256i load_mask = _mm256_castpd_si256(active);
+    const __m256d cx = _mm256_sub_pd(
+        _mm256_maskload_pd(spheres.center_x + k, load_mask), ox);
+    const __m256d cy = _mm256_sub_pd(
+        _mm256_maskload_pd(spheres.center_y + k, load_mask), oy);
+    const __m256d cz = _mm256_sub_pd(
+        _mm256_maskload_pd(spheres.center_z + k, load_mask), oz);
+    const __m256d radius = _mm256_maskload_pd(spheres.radius + k, load_mask);
+
+    const __m256d h =
+        _mm256_fmadd_pd(dx, cx, _mm256_fmadd_pd(dy, cy, _mm256_mul_pd(dz, cz)));
+    const __m256d c = _mm256_fmadd_pd(
+        cx, cx,
+        _mm256_fmadd_pd(cy, cy,
+                        _mm256_fmsub_pd(cz, cz, _mm256_mul_pd(radius, radius))));
+    const __m256d discriminant = _mm256_fmsub_pd(h, h, _mm256_mul_pd(a, c));
+    const __m256d has_root = _mm256_and_pd(
+        active, _mm256_cmp_pd(discriminant, zero, _CMP_GE_OQ));
+
+    const __m256d sqrt_discriminant =
+        _mm256_sqrt_pd(_mm256_max_pd(discriminant, zero));
+    const __m256d near_root =
+        _mm256_div_pd(_mm256_sub_pd(h, sqrt_discriminant), a);
+    const __m256d far_root =
+        _mm256_div_pd(_mm256_add_pd(h, sqrt_discriminant), a);
+
+    // Nearer root if in range, otherwise the farther one
+    const __m256d near_in_range =
+        _mm256_and_pd(_mm256_cmp_pd(near_root, t_minimum, _CMP_GT_OQ),
+                      _mm256_cmp_pd(near_root, best_t, _CMP_LT_OQ));
+    const __m256d root = _mm256_blendv_pd(far_root, near_root, near_in_range);
+    const __m256d in_range = _mm256_and_pd(
+        has_root, _mm256_and_pd(_mm256_cmp_pd(root, t_minimum, _CMP_GT_OQ),
+                                _mm256_cmp_pd(root, best_t, _CMP_LT_OQ)));
+
+    best_t = _mm256_blendv_pd(best_t, root, in_range);
+    best_k = _mm256_blendv_pd(best_k, lane_k, in_range);
+  }
+
+  // Reduce the lanes to the nearest hit
+  alignas(32) double lane_t[4], lane_index[4];
+  _mm256_store_pd(lane_t, best_t);
+  _mm256_store_pd(lane_index, best_k);
+  long nearest = -1;
+  for (int lane = 0; lane < 4; lane++) {
+    if (lane_index[lane] >= 0 && lane_t[lane] < closest) {
+      closest = lane_t[lane];
+      nearest = long(lane_index[lane]);
+    }
+  }
+  return nearest;
+}
+
+// One ray against 8 spheres per iteration, a full soup in one
+__attribute__((target("avx512f"))) long
+nearest_avx512(const sphere_arrays &spheres, const ray &r, double t_min,
+               double &closest) {
+  const point3 &origin = r.origin();
+  const vec3 &direction = r.direction();
+
+  const __m512d ox = _mm512_set1_pd(origin.x());
+  const __m512d oy = _mm512_set1_pd(origin.y());
+  const __m512d oz = _mm512_set1_pd(origin.z());
+  const __m512d dx = _mm512_set1_pd(direction.x());
+  const __m512d dy = _mm512_set1_pd(direction.y());
+  const __m512d dz = _mm512_set1_pd(direction.z());
+  const __m512d a = _mm512_set1_pd(direction.length_squared());
+  const __m512d t_minimum = _mm512_set1_pd(t_min);
+  const __m512d zero = _mm512_setzero_pd();
+
+  // Nearest t and sphere index found by every lane
+  __m512d best_t = _mm512_set1_pd(closest);
+  __m512d best_k = _mm512_set1_pd(-1.0);
+  __m512d lane_k = _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0);
+  const __m512d step = _mm512_set1_pd(8.0);
+
+  for (size_t k = 0; k < spheres.count;
+       k += 8, lane_k = _mm512_add_pd(lane_k, step)) {
+    // Lanes past the last sphere load nothing and never hit
+    const size_t remaining = spheres.count - k;
+    const __mmask8 active =
+        remaining >= 8 ? __mmask8(0xff) : __mmask8((1u << remaining) - 1);
+    const __m512d cx =
+        _mm512_sub_pd(_mm512_maskz_loadu_pd(active, spheres.center_x + k), ox);
+    const __m512d cy =
+        _mm512_sub_pd(_mm512_maskz_loadu_pd(active, spheres.center_y + k), oy);
+    const __m512d cz =
+        _mm512_sub_pd(_mm512_maskz_loadu_pd(active, spheres.center_z + k), oz);
+    const __m512d radius = _mm512_maskz_loadu_pd(active, spheres.radius + k);
+
+    const __m512d h =
+        _mm512_fmadd_pd(dx, cx, _mm512_fmadd_pd(dy, cy, _mm512_mul_pd(dz, cz)));
+    const __m512d c = _mm512_fmadd_pd(
+        cx, cx,
+        _mm512_fmadd_pd(cy, cy,
+                        _mm512_fmsub_pd(cz, cz, _mm512_mul_pd(radius, radius))));
+    const __m512d discriminant = _mm512_fmsub_pd(h, h, _mm512_mul_pd(a, c));
+    const __mmask8 has_root =
+        _mm512_mask_cmp_pd_mask(active, discriminant, zero, _CMP_GE_OQ);
+
+    // Lanes without a root get 0 rather than an undefined value, and their
+    // roots are masked out below anyway
+    const __m512d sqrt_discriminant =
+        _mm512_mask_sqrt_pd(zero, has_root, discriminant);
+    const __m512d near_root =
+        _mm512_div_pd(_mm512_sub_pd(h, sqrt_discriminant), a);
+    const __m512d far_root =
+        _mm512_div_pd(_mm512_add_pd(h, sqrt_discriminant), a);
+
+    // Nearer root if in range, otherwise the farther one
+    const __mmask8 near_in_range =
+        _mm512_cmp_pd_mask(near_root, t_minimum, _CMP_GT_OQ) &
+        _mm512_cmp_pd_mask(near_root, best_t, _CMP_LT_OQ);
+    const __m512d root = _mm512_mask_blend_pd(near_in_range, far_root, near_root);
+    const __mmask8 in_range = has_root &
+                              _mm512_cmp_pd_mask(root, t_minimum, _CMP_GT_OQ) &
+                              _mm512_cmp_pd_mask(root, best_t, _CMP_LT_OQ);
+
+    best_t = _mm512_mask_blend_pd(in_range, best_t, root);
+    best_k = _mm512_mask_blend_pd(in_range, best_k, lane_k);
+  }
+
+  // Reduce the lanes to the nearest hit
+  alignas(64) double lane_t[8], lane_index[8];
+  _mm512_store_pd(lane_t, best_t);
+  _mm512_store_pd(lane_index, best_k);
+  long nearest = -1;
+  for (int lane = 0; lane < 8; lane++) {
+    if (lane_index[lane] >= 0 && lane_t[lane] < closest) {
+      closest = lane_t[lane];
+      nearest = long(lane_index[lane]);
+    }
+  }
+  return nearest;
+}
+
+// Split the rays of a packet into one array per component, padding the lanes
+// past the last ray with copies of it, whose results are thrown away
+template <size_t lanes>
+void transpose_rays(const ray *rays, size_t count, double (&o)[3][lanes],
+                    double (&d)[3][lanes]) {
+  for (size_t lane = 0; lane < lanes; lane++) {
+    const ray &r = rays[std::min(lane, count - 1)];
+    for (int axis = 0; axis < 3; axis++) {
+      o[axis][lane] = r.origin()[axis];
+      d[axis][lane] = r.direction()[axis];
+    }
+  }
+}
+
+// 4 rays against one sphere per iteration
+__attribute__((target("avx2,fma"))) void
+packet_avx2(const sphere_arrays &spheres, const ray *rays, size_t count,
+            double t_min, double *closest, long *nearest) {
+  const __m256d t_minimum = _mm256_set1_pd(t_min);
+  const __m256d zero = _mm256_setzero_pd();
+
+  for (size_t base = 0; base < count; base += 4) {
+    const size_t active = std::min(count - base, size_t(4));
+    alignas(32) double o[3][4], d[3][4], lane_t[4], lane_index[4];
+    transpose_rays(rays + base, active, o, d);
+    for (size_t lane = 0; lane < 4; lane++) {
+      lane_t[lane] = closest[base + std::min(lane, active - 1)];
+    }
+    const __m256d ox = _mm256_load_pd(o[0]);
+    const __m256d oy = _mm256_load_pd(o[1]);
+    const __m256d oz = _mm256_load_pd(o[2]);
+    const __m256d dx = _mm256_load_pd(d[0]);
+    const __m256d dy = _mm256_load_pd(d[1]);
+    const __m256d dz = _mm256_load_pd(d[2]);
+    const __m256d a =
+        _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dz, dz)));
+
+    __m256d best_t = _mm256_load_pd(lane_t);
+    __m256d best_k = _mm256_set1_pd(-1.0);
+
+    for (size_t k = 0; k < spheres.count; k++) {
+      const __m256d cx = _mm256_sub_pd(_mm256_set1_pd(spheres.center_x[k]), ox);
+      const __m256d cy = _mm256_sub_pd(_mm256_set1_pd(spheres.center_y[k]), oy);
+      const __m256d cz = _mm256_sub_pd(_mm256_set1_pd(spheres.center_z[k]), oz);
+      const __m256d radius_squared =
+          _mm256_set1_pd(spheres.radius[k] * spheres.radius[k]);
+
+      const __m256d h = _mm256_fmadd_pd(
+          dx, cx, _mm256_fmadd_pd(dy, cy, _mm256_mul_pd(dz, cz)));
+      const __m256d c = _mm256_fmadd_pd(
+          cx, cx,
+          _mm256_fmadd_pd(cy, cy, _mm256_fmsub_pd(cz, cz, radius_squared)));
+      const __m256d discriminant = _mm256_fmsub_pd(h, h, _mm256_mul_pd(a, c));
+      const __m256d has_root = _mm256_cmp_pd(discriminant, zero, _CMP_GE_OQ);
+
+      const __m256d sqrt_discriminant =
+          _mm256_sqrt_pd(_mm256_max_pd(discriminant, zero));
+      const __m256d near_root =
+          _mm256_div_pd(_mm256_sub_pd(h, sqrt_discriminant), a);
+      const __m256d far_root =
+          _mm256_div_pd(_mm256_add_pd(h, sqrt_discriminant), a);
+
+      // Nearer root if in range, otherwise the farther one
+      const __m256d near_in_range =
+          _mm256_and_pd(_mm256_cmp_pd(near_root, t_minimum, _CMP_GT_OQ),
+                        _mm256_cmp_pd(near_root, best_t, _CMP_LT_OQ));
+      const __m256d root = _mm256_blendv_pd(far_root, near_root, near_in_range);
+      const __m256d in_range = _mm256_and_pd(
+          has_root, _mm256_and_pd(_mm256_cmp_pd(root, t_minimum, _CMP_GT_OQ),
+                                  _mm256_cmp_pd(root, best_t, _CMP_LT_OQ)));
+
+      best_t = _mm256_blendv_pd(best_t, root, in_range);
+      best_k = _mm256_blendv_pd(best_k, _mm256_set1_pd(double(k)), in_range);
+    }
+
+    _mm256_store_pd(lane_t, best_t);
+    _mm256_store_pd(lane_index, best_k);
+    for (size_t lane = 0; lane < active; lane++) {
+      closest[base + lane] = lane_t[lane];
+      nearest[base + lane] = long(lane_index[lane]);
+    }
+  }
+}
+
+// 8 rays against one sphere per iteration
+__attribute__((target("avx512f"))) void
+packet_avx512(const sphere_arrays &spheres, const ray *rays, size_t count,
+              double t_min, double *closest, long *nearest) {
+  const __m512d t_minimum = _mm512_set1_pd(t_min);
+  const __m512d zero = _mm512_setzero_pd();
+
+  for (size_t base = 0; base < count; base += 8) {
+    const size_t active = std::min(count - base, size_t(8));
+    alignas(64) double o[3][8], d[3][8], lane_t[8], lane_index[8];
+    transpose_rays(rays + base, active, o, d);
+    for (size_t lane = 0; lane < 8; lane++) {
+      lane_t[lane] = closest[base + std::min(lane, active - 1)];
+    }
+    const __m512d ox = _mm512_load_pd(o[0]);
+    const __m512d oy = _mm512_load_pd(o[1]);
+    const __m512d oz = _mm512_load_pd(o[2]);
+    const __m512d dx = _mm512_load_pd(d[0]);
+    const __m512d dy = _mm512_load_pd(d[1]);
+    const __m512d dz = _mm512_load_pd(d[2]);
+    const __m512d a =
+        _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+
+    __m512d best_t = _mm512_load_pd(lane_t);
+    __m512d best_k = _mm512_set1_pd(-1.0);
+
+    for (size_t k = 0; k < spheres.count; k++) {
+      const __m512d cx = _mm512_sub_pd(_mm512_set1_pd(spheres.center_x[k]), ox);
+      const __m512d cy = _mm512_sub_pd(_mm512_set1_pd(spheres.center_y[k]), oy);
+      const __m512d cz = _mm512_sub_pd(_mm512_set1_pd(spheres.center_z[k]), oz);
+      const __m512d radius_squared =
+          _mm512_set1_pd(spheres.radius[k] * spheres.radius[k]);
+
+      const __m512d h = _mm512_fmadd_pd(
+          dx, cx, _mm512_fmadd_pd(dy, cy, _mm512_mul_pd(dz, cz)));
+      const __m512d c = _mm512_fmadd_pd(
+          cx, cx,
+          _mm512_fmadd_pd(cy, cy, _mm512_fmsub_pd(cz, cz, radius_squared)));
+      const __m512d discriminant = _mm512_fmsub_pd(h, h, _mm512_mul_pd(a, c));
+      const __mmask8 has_root =
+          _mm512_cmp_pd_mask(discriminant, zero, _CMP_GE_OQ);
+
+      const __m512d sqrt_discriminant =
+          _mm512_mask_sqrt_pd(zero, has_root, discriminant);
+      const __m512d near_root =
+          _mm512_div_pd(_mm512_sub_pd(h, sqrt_discriminant), a);
+      const __m512d far_root =
+          _mm512_div_pd(_mm512_add_pd(h, sqrt_discriminant), a);
+
+      // Nearer root if in range, otherwise the farther one
+      const __mmask8 near_in_range =
+          _mm512_cmp_pd_mask(near_root, t_minimum, _CMP_GT_OQ) &
+          _mm512_cmp_pd_mask(near_root, best_t, _CMP_LT_OQ);
+      const __m512d root =
+          _mm512_mask_blend_pd(near_in_range, far_root, near_root);
+      const __mmask8 in_range =
+          has_root & _mm512_cmp_pd_mask(root, t_minimum, _CMP_GT_OQ) &
+          _mm512_cmp_pd_mask(root, best_t, _CMP_LT_OQ);
+
+      best_t = _mm512_mask_blend_pd(in_range, best_t, root);
+      best_k =
+          _mm512_mask_blend_pd(in_range, best_k, _mm512_set1_pd(double(k)));
+    }
+
+    _mm512_store_pd(lane_t, best_t);
+    _mm512_store_pd(lane_index, best_k);
+    for (size_t lane = 0; lane < active; lane++) {
+      closest[base + lane] = lane_t[lane];
+      nearest[base + lane] = long(lane_index[lane]);
+    }
+  }
+}
+
+#endif
+
+// Kernels of one instruction set
+struct simd_kernels {
+  const char *name;
+  nearest_kernel nearest;
+  packet_kernel packet;
+};
+
+// Every instruction set, the widest first
+const simd_kernels all_kernels[] = {
+#if SPHERE_SOUP_X86_SIMD
+    {"avx512", nearest_avx512, packet_avx512},
+    {"avx2", nearest_avx2, packet_avx2},
+#endif
+    {"scalar", nearest_scalar, packet_scalar},
+};
+
+// Whether the running CPU supports the instruction set
+bool cpu_supports(const simd_kernels &candidate) {
+#if SPHERE_SOUP_X86_SIMD
+  __builtin_cpu_init();
+  if (std::strcmp(candidate.name, "avx512") == 0) {
+    return __builtin_cpu_supports("avx512f");
+  }
+  if (std::strcmp(candidate.name, "avx2") == 0) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  }
+#endif
+  return true;
+}
+
+// Pick the widest instruction set the running CPU supports
+simd_kernels select_kernels() {
+  for (const auto &candidate : all_kernels) {
+    if (cpu_supports(candidate)) {
+      return candidate;
+    }
+  }
+  return all_kernels[std::size(all_kernels) - 1];
+}
+
+simd_kernels kernels = select_kernels();
+
+} // namespace
+
+// Add a sphere
+void sphere_soup::add(const point3 &center, double radius,
+                      const material *mat) {
+  const double r = std::max(0.0, radius);
+  center_x[count] = center.x();
+  center_y[count] = center.y();
+  center_z[count] = center.z();
+  this->radius[count] = r;
+  materials[count] = mat;
+  count++;
+
+  // Grow the bounding box
+  const vec3 radius_vector(r, r, r);
+  bbox = aabb(bbox, aabb(center - radius_vector, center + radius_vector));
+}
+
+void sphere_soup::add(const sphere &s) { add(s.center, s.radius, s.mat); }
+
+// Number of spheres
+size_t sphere_soup::size() const { return count; }
+
+// Fill the record for a hit at t on sphere k
+void sphere_soup::fill_record(const ray &r, size_t k, double t,
+                              hit_record &record) const {
+  record.t = t;
+  record.point = r.at(t);
+  const point3 center(center_x[k], center_y[k], center_z[k]);
+  const vec3 outward_normal = (record.point - center) / radius[k];
+  record.set_face_normal(r, outward_normal);
+  record.mat = materials[k];
+}
+
+// Determine the nearest sphere hit by the ray, testing several at once
+bool sphere_soup::hit(const ray &r, interval ray_t, hit_record &record) const {
+  count_object_tests(size());
+
+  const sphere_arrays spheres{center_x.data(), center_y.data(),
+                              center_z.data(), radius.data(), size()};
+
+  double closest = ray_t.max;
+  const long nearest = kernels.nearest(spheres, r, ray_t.min, closest);
+  if (nearest < 0) {
+    return false;
+  }
+
+  fill_record(r, size_t(nearest), closest, record);
+  return true;
+}
+
+// Determine if the ray hits any sphere
+// NOTE: the kernels test every sphere of the soup together anyway, so the
+// nearest kernel costs no more than stopping at the first hit would
+bool sphere_soup::occluded(const ray &r, interval ray_t) const {
+  count_object_tests(size());
+
+  const sphere_arrays spheres{center_x.data(), center_y.data(),
+                              center_z.data(), radius.data(), size()};
+
+  double closest = ray_t.max;
+  return kernels.nearest(spheres, r, ray_t.min, closest) >= 0;
+}
+
+aabb sphere_soup::bounding_box() const { return bbox; }
+
+// Trace a packet of rays, testing several rays against one sphere at once
+void sphere_soup::hit_packet(const ray *rays, size_t count, interval ray_t,
+                             hit_record *records, bool *hits) const {
+  count_object_tests(uint64_t(count) * size());
+
+  const sphere_arrays spheres{center_x.data(), center_y.data(),
+                              center_z.data(), radius.data(), size()};
+
+  // One kernel call per max_packet_size rays, the results on the stack
+  for (size_t base = 0; base < count; base += max_packet_size) {
+    const size_t packet = std::min(count - base, max_packet_size);
+    double closest[max_packet_size];
+    long nearest[max_packet_size];
+    std::fill_n(closest, packet, double(ray_t.max));
+    kernels.packet(spheres, rays + base, packet, ray_t.min, closest, nearest);
+
+    for (size_t k = 0; k < packet; k++) {
+      hits[base + k] = nearest[k] >= 0;
+      if (hits[base + k]) {
+        fill_record(rays[base + k], size_t(nearest[k]), closest[k],
+                    records[base + k]);
+      }
+    }
+  }
+}
+
+// Name of the instruction set selected at runtime
+const char *sphere_soup::simd_name() { return kernels.name; }
+
+// Use the named instruction set instead of the selected one
+bool sphere_soup::select_simd(const char *name) {
+  for (const auto &candidate : all_kernels) {
+    if (std::strcmp(candidate.name, name) == 0 && cpu_supports(candidate)) {
+      kernels = candidate;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "hittables/hittable.h"
+#include "hittables/triangle_mesh.h"
+#include "utils/counters.h"
+#include "utils/ray.h"
+#include "utils/rtweekend.h"
+
+namespace {
+
+// Ray transformed once per mesh for the watertight ray-triangle test of
+// Woop, Benthin and Wald (2013): the largest direction axis becomes z and the
+// direction is sheared onto it, so every edge test is a 2D cross product
+// computed the same way for triangles sharing the edge, and no ray slips
+// through the gap between them
+struct sheared_ray {
+  point3 origin;
+  int kx, ky, kz;
+  real sx, sy, sz;
+
+  explicit sheared_ray(const ray &r) : origin(r.origin()) {
+    const vec3 &d = r.direction();
+    kz = 0;
+    if (std::fabs(d[1]) > std::fabs(d[kz])) {
+      kz = 1;
+    }
+    if (std::fabs(d[2]) > std::fabs(d[kz])) {
+      kz = 2;
+    }
+    kx = (kz + 1) % 3;
+    ky = (kx + 1) % 3;
+    // Keep the winding of the triangles
+    if (d[kz] < 0) {
+      std::swap(kx, ky);
+    }
+    sx = d[kx] / d[kz];
+    sy = d[ky] / d[kz];
+    sz = real(1) / d[kz];
+  }
+};
+
+// Parameter t of the hit of the ray on triangle a, b, c, or false on a miss
+bool hit_triangle(const sheared_ray &r, const point3 &a, const point3 &b,
+                  const point3 &c, real &t) {
+  // Vertices relative to the origin, sheared into ray space
+  const vec3 pa = a - r.origin;
+  const vec3 pb = b - r.origin;
+  const vec3 pc = c - r.origin;
+  const real ax = pa[r.kx] - r.sx * pa[r.kz];
+  const real ay = pa[r.ky] - r.sy * pa[r.kz];
+  const real bx = pb[r.kx] - r.sx * pb[r.kz];
+  const real by = pb[r.ky] - r.sy * pb[r.kz];
+  const real cx = pc[r.kx] - r.sx * pc[r.kz];
+  const real cy = pc[r.ky] - r.sy * pc[r.kz];
+
+  // Scaled barycentric coordinates, all of one sign inside the triangle
+  // NOTE: the float paper falls back to double for exact zeros, in double
+  // builds they already are
+  const real u = cx * by - cy * bx;
+  const real v = ax * cy - ay * cx;
+  const real w = bx * ay - by * ax;
+  if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0)) {
+    return false;
+  }
+
+  // Edge-on to the ray
+  const real determinant = u + v + w;
+  if (determinant == 0) {
+    return false;
+  }
+
+  const real scaled_t =
+      r.sz * (u * pa[r.kz] + v * pb[r.kz] + w * pc[r.kz]);
+  t = scaled_t / determinant;
+  return true;
+}
+
+// Box of one triangle, padded by the rounding error of its coordinates so
+// triangles lying in an axis plane do not get an empty box
+aabb triangle_box(const point3 &a, const point3 &b, const point3 &c) {
+  const aabb box(aabb(a, b), aabb(c, c));
+  const real magnitude = std::max(
+      {real(1), std::fabs(box.x.min), std::fabs(box.x.max),
+       std::fabs(box.y.min), std::fabs(box.y.max), std::fabs(box.z.min),
+       std::fabs(box.z.max)});
+  const real pad = ray_offset_scale * magnitude;
+  return aabb(interval(box.x.min - pad, box.x.max + pad),
+              interval(box.y.min - pad, box.y.max + pad),
+              interval(box.z.min - pad, box.z.max + pad));
+}
+
+} // namespace
+
+// Take over the vertices and triangles and build the BVH over them
+triangle_mesh::triangle_mesh(std::vector<point3> vertices,
+                             std::vector<triangle> triangles,
+                             const material *mat)
+    : vertices(std::move(vertices)), mat(mat) {
+  std::vector<aabb> boxes;
+  boxes.reserve(triangles.size());
+  for (const auto &tri : triangles) {
+    boxes.push_back(triangle_box(this->vertices[tri[0]],
+                                 this->vertices[tri[1]],
+                                 this->vertices[tri[2]]));
+  }
+
+  const std::vector<uint32_t> order = bvh.build(boxes, max_leaf_size);
+
+  // Store the triangles in leaf order
+  this->triangles.reserve(triangles.size());
+  for (const uint32_t k : order) {
+    this->triangles.push_back(triangles[k]);
+  }
+}
+
+size_t triangle_mesh::vertex_count() const { return vertices.size(); }
+
+size_t triangle_mesh::triangle_count() const { return triangles.size(); }
+
+// Determine the nearest triangle hit by the ray
+bool triangle_mesh::hit(const ray &r, interval ray_t,
+                        hit_record &record) const {
+  const sheared_ray sheared(r);
+  size_t hit_triangle_index = 0;
+  bool hit_anything = false;
+
+  bvh.traverse(r, ray_t, [&](size_t first, size_t count, interval &range) {
+    count_object_tests(count);
+    for (size_t k = first; k < first + count; k++) {
+      const triangle &tri = triangles[k];
+      real t;
+      if (hit_triangle(sheared, vertices[tri[0]], vertices[tri[1]],
+                       vertices[tri[2]], t) &&
+          range.surrounds(t)) {
+        range.max = t;
+        hit_triangle_index = k;
+        hit_anything = true;
+      }
+    }
+    return false;
+  });
+
+  if (!hit_anything) {
+    return false;
+  }
+
+  // Fill the record of the nearest hit only
+  const triangle &tri = triangles[hit_triangle_index];
+  const point3 &a = vertices[tri[0]];
+  const vec3 outward_normal =
+      unit_vector(cross(vertices[tri[1]] - a, vertices[tri[2]] - a));
+  record.t = ray_t.max;
+  record.point = r.at(record.t);
+  record.set_face_normal(r, outward_normal);
+  record.mat = mat;
+  return true;
+}
+
+// Determine if the ray hits any triangle, stopping at the first
+bool triangle_mesh::occluded(const ray &r, interval ray_t) const {
+  const sheared_ray sheared(r);
+  bool hit_anything = false;
+
+  bvh.traverse(r, ray_t, [&](size_t first, size_t count, interval &range) {
+    count_object_tests(count);
+    for (size_t k = first; k < first + count; k++) {
+      const triangle &tri = triangles[k];
+      real t;
+      if (hit_triangle(sheared, vertices[tri[0]], vertices[tri[1]],
+                       vertices[tri[2]], t) &&
+          range.surrounds(t)) {
+        hit_anything = true;
+        return true;
+      }
+    }
+    return false;
+  });
+  return hit_anything;
+}
+
+aabb triangle_mesh::bounding_box() const { return bvh.bounding_box(); }
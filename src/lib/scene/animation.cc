@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <iostream>
+
+#include <toml++/toml.hpp>
+
+#include "scene/animation.h"
+#include "utils/vec3.h"
+
+// Camera at a frame
+camera_keyframe camera_path::at(int frame) const {
+  // First keyframe after the frame
+  const auto next = std::upper_bound(
+      keyframes.begin(), keyframes.end(), frame,
+      [](int f, const camera_keyframe &key) { return f < key.frame; });
+  if (next == keyframes.begin()) {
+    return {frame, keyframes.front().look_from, keyframes.front().look_at};
+  }
+  if (next == keyframes.end()) {
+    return {frame, keyframes.back().look_from, keyframes.back().look_at};
+  }
+
+  // Blend the keyframes around the frame
+  const auto &before = *(next - 1);
+  const auto &after = *next;
+  const real blend = real(frame - before.frame) / (after.frame - before.frame);
+  return {frame, (1 - blend) * before.look_from + blend * after.look_from,
+          (1 - blend) * before.look_at + blend * after.look_at};
+}
+
+// Load the [Animation] section and [[Keyframe]] tables of the config
+bool load_camera_path(const toml::table &config, camera_path &path) {
+  const auto frames_node = config["Animation"]["frames"].as_integer();
+  if (!frames_node || frames_node->get() <= 0) {
+    std::cerr << "Error: [Animation] frames must be a positive integer.\n";
+    return false;
+  }
+  path.frames = int(frames_node->get());
+
+  const auto keyframes_node = config["Keyframe"].as_array();
+  if (!keyframes_node || keyframes_node->empty()) {
+    std::cerr << "Error: An animation needs at least one [[Keyframe]] table.\n";
+    return false;
+  }
+
+  path.keyframes.clear();
+  for (const auto &k : *keyframes_node) {
+    const auto k_table_node = k.as_table();
+    if (!k_table_node) {
+      std::cerr << "Error: Keyframe configuration is not a valid table.\n";
+      return false;
+    }
+    const auto &k_table = *k_table_node;
+
+    const auto frame_node = k_table["frame"].as_integer();
+    if (!frame_node || frame_node->get() < 0) {
+      std::cerr << "Error: Keyframe frame must be a non-negative integer.\n";
+      return false;
+    }
+
+    camera_keyframe key{int(frame_node->get()), point3(), point3()};
+    const auto look_from_node = k_table["look_from"].as_array();
+    const auto look_at_node = k_table["look_at"].as_array();
+    if (!look_from_node || !array_to_vec3(*look_from_node, key.look_from) ||
+        !look_at_node || !array_to_vec3(*look_at_node, key.look_at)) {
+      std::cerr << "Error: Keyframe look_from and look_at must be arrays of "
+                   "three finite numbers.\n";
+      return false;
+    }
+
+    if ((key.look_from - key.look_at).near_zero()) {
+      std::cerr << "Error: Keyframe " << key.frame
+                << " has the same look_from and look_at.\n";
+      return false;
+    }
+    path.keyframes.push_back(key);
+  }
+
+  std::sort(path.keyframes.begin(), path.keyframes.end(),
+            [](const camera_keyframe &a, const camera_keyframe &b) {
+              return a.frame < b.frame;
+            });
+  for (size_t k = 1; k < path.keyframes.size(); k++) {
+    if (path.keyframes[k].frame == path.keyframes[k - 1].frame) {
+      std::cerr << "Error: Two keyframes share frame "
+                << path.keyframes[k].frame << ".\n";
+      return false;
+    }
+  }
+
+  return true;
+}
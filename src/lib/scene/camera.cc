@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
-#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -11,9 +16,32 @@
 #include "hittables/hittable.h"
 #include "hittables/material.h"
 #include "scene/camera.h"
+#include "scene/light_list.h"
+#include "scene/wavefront.h"
+#include "utils/arena.h"
+#include "utils/counters.h"
+#include "utils/interval.h"
 #include "utils/rtweekend.h"
+#include "utils/thread_pool.h"
 #include "utils/vec3.h"
 
+// Shadow rays stop this fraction of the distance short of the sampled light,
+// so rounding of the light's own intersection never counts as occlusion
+static constexpr real shadow_ray_margin = real(1e-4);
+
+// Ray segments traced by the current thread, read by for_each_tile
+static thread_local uint64_t rays_traced = 0;
+
+// Scratch memory of the calling render thread, emptied at once per tile
+static arena &tile_scratch() {
+  static thread_local arena scratch;
+  return scratch;
+}
+
+// Paths of one wavefront batch at most, a tile takes several batches if its
+// samples do not fit
+static constexpr size_t max_wavefront_paths = size_t(1) << 14;
+
 // Constructor
 camera::camera(const toml::table &config) {
   try {
@@ -91,7 +119,7 @@ void camera::initialize(const toml::table &config) {
       throw std::runtime_error("v_fov必须是浮点数");
     }
 
-    const auto v_fov = v_fov_node->get();
+    v_fov = v_fov_node->get();
     if (v_fov <= 0 || v_fov >= 180) {
       throw std::runtime_error("v_fov必须在0到180之间");
     }
@@ -101,9 +129,7 @@ void camera::initialize(const toml::table &config) {
     if (!look_from_node || look_from_node->size() != 3) {
       throw std::runtime_error("look_from必须是包含3个元素的数组");
     }
-
     const vec3 look_from(*look_from_node);
-    camera_center = look_from;
 
     // 获取并验证look_at
     const auto look_at_node = config["Camera"]["look_at"].as_array();
@@ -117,41 +143,9 @@ void camera::initialize(const toml::table &config) {
     if (!vup_node || vup_node->size() != 3) {
       throw std::runtime_error("vup必须是包含3个元素的数组");
     }
-    const vec3 vup(*vup_node);
-
-    // Calculate the focal length
-    const auto focal_length = (look_from - look_at).length();
-    // Calculate the viewport height based on the vertical field of view
-    // Convert degrees to radians
-    const double theta = degrees_to_radians(v_fov);
-    // Calculate the half height of the viewport
-    const double half_height = std::tan(theta / 2);
-    // Calculate the viewport height
-    const double viewport_height = 2.0 * half_height * focal_length;
-
-    // Use image width / image height instead of aspect_ratio to match the image
-    // Aspect ratio does not always match the viewport aspect ratio
-    const double viewport_width =
-        viewport_height * double(image_width) / double(image_height);
-
-    // Calculate the u, v, w unit basis vectors for the camera coordinate frame
-    w = unit_vector(look_from - look_at);
-    u = unit_vector(cross(vup, w));
-    v = cross(w, u);
-
-    // Calculate the vectors across the horizontal and down the vertical
-    // viewport edges.
-    const auto viewport_u = viewport_width * u;
-    const auto viewport_v = viewport_height * -v;
-
-    // Calculate the horizontal and vertical delta vectors from pixel to pixel
-    pixel_u = viewport_u / double(image_width);
-    pixel_v = viewport_v / double(image_height);
-
-    // Calculate the location of the upper left pixel
-    const auto viewport_upper_left = camera_center - (focal_length * w) -
-                                     (0.5 * viewport_u) - (0.5 * viewport_v);
-    pixel00_location = viewport_upper_left + 0.5 * (pixel_u + pixel_v);
+    vup = vec3(*vup_node);
+
+    set_view(look_from, look_at);
 
     // 获取并验证采样数
     const auto samples_node =
@@ -168,6 +162,28 @@ void camera::initialize(const toml::table &config) {
     // Scale for pixel samples (1 / samples_per_pixel)
     pixel_samples_scale = 1.0 / double(samples_per_pixel);
 
+    // 获取并验证快门区间 (可选), 运动物体在时间 0 到 1 之间移动
+    shutter_open = 0;
+    shutter_close = 0;
+    if (config["Camera"].as_table()->contains("shutter_open") ||
+        config["Camera"].as_table()->contains("shutter_close")) {
+      const auto open_node =
+          config["Camera"]["shutter_open"].as_floating_point();
+      const auto close_node =
+          config["Camera"]["shutter_close"].as_floating_point();
+      if (!open_node || !close_node) {
+        throw std::runtime_error(
+            "shutter_open 和 shutter_close 必须同时给出且是浮点数");
+      }
+      shutter_open = open_node->get();
+      shutter_close = close_node->get();
+      if (!(0 <= shutter_open && shutter_open <= shutter_close &&
+            shutter_close <= 1)) {
+        throw std::runtime_error(
+            "快门区间必须满足 0 <= shutter_open <= shutter_close <= 1");
+      }
+    }
+
     // Color 部分验证
     if (!config["Color"].as_table()->contains("white") ||
         !config["Color"].as_table()->contains("blue")) {
@@ -218,6 +234,137 @@ void camera::initialize(const toml::table &config) {
     if (max_depth <= 0) {
       throw std::runtime_error("最大光线深度必须为正整数");
     }
+
+    // 获取并验证俄罗斯轮盘赌起始深度 (可选)
+    roulette_depth = 3;
+    if (config["Ray"].as_table()->contains("roulette_depth")) {
+      const auto roulette_node = config["Ray"]["roulette_depth"].as_integer();
+      if (!roulette_node) {
+        throw std::runtime_error("俄罗斯轮盘赌起始深度必须是整数");
+      }
+      roulette_depth = roulette_node->get();
+      if (roulette_depth < 0) {
+        throw std::runtime_error("俄罗斯轮盘赌起始深度必须为非负整数");
+      }
+    }
+
+    // Render 部分为可选项
+    seed = 0;
+    render_threads = 0;
+    tile_size = 16;
+    adaptive = false;
+    min_samples_per_pixel = 16;
+    samples_per_pass = 16;
+    noise_threshold = 0.005;
+    wavefront = false;
+    sort_rays = false;
+    if (config.contains("Render")) {
+      if (!config["Render"].is_table()) {
+        throw std::runtime_error("Render 部分必须是表");
+      }
+
+      // 获取并验证随机种子
+      if (config["Render"].as_table()->contains("seed")) {
+        const auto seed_node = config["Render"]["seed"].as_integer();
+        if (!seed_node) {
+          throw std::runtime_error("随机种子必须是整数");
+        }
+        if (seed_node->get() < 0) {
+          throw std::runtime_error("随机种子必须为非负整数");
+        }
+        seed = uint64_t(seed_node->get());
+      }
+
+      // 获取并验证线程数 (0 表示使用全部硬件线程)
+      if (config["Render"].as_table()->contains("threads")) {
+        const auto threads_node = config["Render"]["threads"].as_integer();
+        if (!threads_node) {
+          throw std::runtime_error("线程数必须是整数");
+        }
+        render_threads = threads_node->get();
+        if (render_threads < 0) {
+          throw std::runtime_error("线程数必须为非负整数");
+        }
+      }
+
+      // 获取并验证图块大小
+      if (config["Render"].as_table()->contains("tile_size")) {
+        const auto tile_size_node = config["Render"]["tile_size"].as_integer();
+        if (!tile_size_node) {
+          throw std::runtime_error("图块大小必须是整数");
+        }
+        tile_size = tile_size_node->get();
+        if (tile_size <= 0) {
+          throw std::runtime_error("图块大小必须为正整数");
+        }
+      }
+
+      // 获取并验证自适应采样参数
+      if (config["Render"].as_table()->contains("adaptive")) {
+        const auto adaptive_node = config["Render"]["adaptive"].as_boolean();
+        if (!adaptive_node) {
+          throw std::runtime_error("adaptive 必须是布尔值");
+        }
+        adaptive = adaptive_node->get();
+      }
+
+      if (config["Render"].as_table()->contains("min_samples")) {
+        const auto min_samples_node =
+            config["Render"]["min_samples"].as_integer();
+        if (!min_samples_node) {
+          throw std::runtime_error("最小采样数必须是整数");
+        }
+        min_samples_per_pixel = min_samples_node->get();
+        if (min_samples_per_pixel <= 0) {
+          throw std::runtime_error("最小采样数必须为正整数");
+        }
+      }
+
+      if (config["Render"].as_table()->contains("pass_samples")) {
+        const auto pass_samples_node =
+            config["Render"]["pass_samples"].as_integer();
+        if (!pass_samples_node) {
+          throw std::runtime_error("每轮采样数必须是整数");
+        }
+        samples_per_pass = pass_samples_node->get();
+        if (samples_per_pass <= 0) {
+          throw std::runtime_error("每轮采样数必须为正整数");
+        }
+      }
+
+      if (config["Render"].as_table()->contains("noise_threshold")) {
+        const auto threshold_node =
+            config["Render"]["noise_threshold"].as_floating_point();
+        if (!threshold_node) {
+          throw std::runtime_error("噪声阈值必须是浮点数");
+        }
+        noise_threshold = threshold_node->get();
+        if (noise_threshold <= 0) {
+          throw std::runtime_error("噪声阈值必须为正数");
+        }
+      }
+
+      // 获取波前 (wavefront) 渲染开关
+      if (config["Render"].as_table()->contains("wavefront")) {
+        const auto wavefront_node = config["Render"]["wavefront"].as_boolean();
+        if (!wavefront_node) {
+          throw std::runtime_error("wavefront 必须是布尔值");
+        }
+        wavefront = wavefront_node->get();
+      }
+
+      // 获取光线重排开关, 仅用于波前渲染
+      if (config["Render"].as_table()->contains("sort_rays")) {
+        const auto sort_rays_node = config["Render"]["sort_rays"].as_boolean();
+        if (!sort_rays_node) {
+          throw std::runtime_error("sort_rays 必须是布尔值");
+        }
+        sort_rays = sort_rays_node->get();
+      }
+    }
+
+    // 最小采样数不超过每像素采样数
+    min_samples_per_pixel = std::min(min_samples_per_pixel, samples_per_pixel);
   } catch (const toml::parse_error &e) {
     throw std::runtime_error("TOML解析错误: " + std::string(e.what()));
   } catch (const std::exception &e) {
@@ -225,6 +372,56 @@ void camera::initialize(const toml::table &config) {
   }
 }
 
+// Sample these lights directly at diffuse hits
+void camera::set_lights(const light_list *lights) { this->lights = lights; }
+
+// Move the camera to look_from, looking at look_at
+void camera::set_view(const point3 &look_from, const point3 &look_at) {
+  // look_from 与 look_at 不能重合, vup 不能与视线方向平行
+  if ((look_from - look_at).near_zero()) {
+    throw std::runtime_error("look_from 与 look_at 不能重合");
+  }
+  if (cross(vup, look_from - look_at).near_zero()) {
+    throw std::runtime_error("vup 不能为零或与视线方向平行");
+  }
+
+  camera_center = look_from;
+
+  // Calculate the focal length
+  const auto focal_length = (look_from - look_at).length();
+  // Calculate the viewport height based on the vertical field of view
+  // Convert degrees to radians
+  const double theta = degrees_to_radians(v_fov);
+  // Calculate the half height of the viewport
+  const double half_height = std::tan(theta / 2);
+  // Calculate the viewport height
+  const double viewport_height = 2.0 * half_height * focal_length;
+
+  // Use image width / image height instead of aspect_ratio to match the image
+  // Aspect ratio does not always match the viewport aspect ratio
+  const double viewport_width =
+      viewport_height * double(image_width) / double(image_height);
+
+  // Calculate the u, v, w unit basis vectors for the camera coordinate frame
+  w = unit_vector(look_from - look_at);
+  u = unit_vector(cross(vup, w));
+  v = cross(w, u);
+
+  // Calculate the vectors across the horizontal and down the vertical
+  // viewport edges.
+  const auto viewport_u = viewport_width * u;
+  const auto viewport_v = viewport_height * -v;
+
+  // Calculate the horizontal and vertical delta vectors from pixel to pixel
+  pixel_u = viewport_u / double(image_width);
+  pixel_v = viewport_v / double(image_height);
+
+  // Calculate the location of the upper left pixel
+  const auto viewport_upper_left = camera_center - (focal_length * w) -
+                                   (0.5 * viewport_u) - (0.5 * viewport_v);
+  pixel00_location = viewport_upper_left + 0.5 * (pixel_u + pixel_v);
+}
+
 // Returns the vector to a random point in the [-.5,-.5]-[+.5,+.5] unit square
 vec3 camera::sample_square() const {
   return vec3(random_double() - 0.5, random_double() - 0.5, 0);
@@ -240,150 +437,591 @@ ray camera::get_ray(int i, int j) const {
                             (j + offset.y()) * pixel_v;
   const auto ray_origin = camera_center;
   const auto ray_direction = pixel_center - ray_origin;
+  // Random time within the shutter interval, an instantaneous shutter draws
+  // no random number
+  real ray_time = shutter_open;
+  if (shutter_close > shutter_open) {
+    ray_time += real(random_double()) * (shutter_close - shutter_open);
+  }
 
   // Return the ray
-  return ray(ray_origin, ray_direction);
+  return ray(ray_origin, ray_direction, ray_time);
+}
+
+// Average color of samples_per_pixel rays through pixel i, j
+color camera::render_pixel(int i, int j, const hittable &world) const {
+  // Using multiple samples per pixel
+  color average_color(0, 0, 0);
+  for (int sample = 0; sample < samples_per_pixel; sample++) {
+    // Create a ray from the camera to the pixel
+    const auto r = get_ray(i, j);
+    // Add sample color to the average color
+    average_color += ray_color(r, world);
+  }
+  average_color *= pixel_samples_scale;
+  return average_color;
 }
 
 // Single threaded render function
-void camera::render(const hittable &world, std::ofstream &output_file) const {
+framebuffer camera::render(const hittable &world) const {
   // Render
 
-  output_file << "P3\n" << image_width << ' ' << image_height << "\n255\n";
+  // Seed the generator of this thread for a reproducible image
+  seed_random(seed);
+
+  framebuffer image(image_width, image_height);
 
   for (int j = 0; j < image_height; j++) {
     std::clog << "\rScanlines remaining: " << (image_height - j) << ' '
               << std::flush;
     for (int i = 0; i < image_width; i++) {
-      // Using multiple samples per pixel
-      color average_color(0, 0, 0);
-      for (int sample = 0; sample < samples_per_pixel; sample++) {
-        // Create a ray from the camera to the pixel
-        const auto r = get_ray(i, j);
-        // Add sample color to the average color
-        average_color += ray_color(r, max_depth, world);
-      }
-      average_color *= pixel_samples_scale;
-      write_color(output_file, average_color);
+      image.set(i, j, render_pixel(i, j, world));
     }
   }
 
   std::clog << "\rDone.                 \n";
+  return image;
 }
 
-// Multithreaded render function
-void camera::render_multithread(const hittable &world,
-                                std::ofstream &output_file) const {
-  // Threads
-  const int num_threads = std::thread::hardware_concurrency();
+// Run render_tile on every tile of the image, spread over the render threads
+void camera::for_each_tile(
+    const std::string &label,
+    const std::function<void(const tile &)> &render_tile,
+    render_stats *stats) const {
+  const auto start_time = std::chrono::steady_clock::now();
+
+  const int num_threads = thread_count();
 
-  // Thread array
-  std::vector<std::thread> threads(num_threads);
+  // Split the image into square tiles, in row-major order
+  const int tile_count = this->tile_count();
 
-  // Create Buffer
-  std::vector<std::string> buffers(num_threads);
+  // Index of the next tile to hand out, workers pull tiles from it until all
+  // tiles are taken, so threads finishing cheap tiles simply take more
+  std::atomic<int> next_tile(0);
 
-  // Also Mutex for counting scanlines
+  // Also Mutex for printing progress and merging statistics
   std::mutex progress_mutex;
+  int tiles_done = 0;
+
+  if (stats != nullptr && int(stats->tile_seconds.size()) < tile_count) {
+    stats->tile_seconds.resize(tile_count, 0.0);
+  }
+
+  auto render_tiles_parallel = [&]() -> void {
+    rays_traced = 0;
+    thread_counters = render_counters();
+    for (int index = next_tile++; index < tile_count; index = next_tile++) {
+      const tile t = tile_at(index);
 
-  const int rows_per_thread = image_height / num_threads;
+      const auto tile_start = std::chrono::steady_clock::now();
+      render_tile(t);
+      const auto tile_end = std::chrono::steady_clock::now();
 
-  auto render_rows_parallel =
-      [this](const int start_row, const int end_row, const hittable &world,
-             std::string &output_buffer, std::mutex &progress_mutex,
-             int &progress) -> void {
-    // Stringstream to store the result
-    std::stringstream result;
-    for (int j = start_row; j < end_row; j++) {
       {
         const std::lock_guard<std::mutex> lock(progress_mutex);
-        std::clog << "\rScanlines: " << (progress + 1) << '/' << image_height
+        tiles_done++;
+        std::clog << '\r' << label << ": " << tiles_done << '/' << tile_count
                   << std::flush;
-        progress++;
-      }
 
-      for (int i = 0; i < image_width; i++) {
-        // Using multiple samples per pixel
-        color average_color(0, 0, 0);
-        for (int sample = 0; sample < samples_per_pixel; sample++) {
-          // Create a ray from the camera to the pixel
-          const auto r = get_ray(i, j);
-          // Add sample color to the average color
-          average_color += ray_color(r, max_depth, world);
+        if (stats != nullptr) {
+          stats->tile_seconds[index] +=
+              std::chrono::duration<double>(tile_end - tile_start).count();
+          if (stats->first_tile_seconds == 0) {
+            stats->first_tile_seconds =
+                std::chrono::duration<double>(tile_end - start_time).count();
+          }
         }
-        average_color *= pixel_samples_scale;
-        write_color(result, average_color);
       }
     }
 
-    // Add the result to the output buffer
-    output_buffer += result.str();
+    // Merge the rays traced and the counters of this thread
+    if (stats != nullptr) {
+      const std::lock_guard<std::mutex> lock(progress_mutex);
+      stats->rays += rays_traced;
+      stats->counters.merge(thread_counters);
+    }
   };
 
-  // Render
+  // Threads are started by the first render and kept for the later ones
+  if (!pool) {
+    pool = std::make_unique<thread_pool>(num_threads);
+  }
+  pool->run_on_all(render_tiles_parallel);
+}
 
-  // Start threads
-  for (int t = 0, progress = 0; t < num_threads; t++) {
-    const int start_row = t * rows_per_thread;
-    const int end_row =
-        (t == num_threads - 1) ? image_height : start_row + rows_per_thread;
-    threads[t] = std::thread(render_rows_parallel, start_row, end_row,
-                             std::ref(world), std::ref(buffers[t]),
-                             std::ref(progress_mutex), std::ref(progress));
+// Tiles per image row
+int camera::tiles_per_row() const {
+  return (image_width + tile_size - 1) / tile_size;
+}
+
+// Tiles of the image
+int camera::tile_count() const {
+  const int tiles_y = (image_height + tile_size - 1) / tile_size;
+  return tiles_per_row() * tiles_y;
+}
+
+// Tile at a row-major index
+camera::tile camera::tile_at(int index) const {
+  tile t;
+  t.index = index;
+  t.start_col = (index % tiles_per_row()) * tile_size;
+  t.start_row = (index / tiles_per_row()) * tile_size;
+  t.end_col = std::min(t.start_col + tile_size, image_width);
+  t.end_row = std::min(t.start_row + tile_size, image_height);
+  return t;
+}
+
+// Render threads, 0 in the config means one per hardware thread
+int camera::thread_count() const {
+  return render_threads > 0
+             ? render_threads
+             : std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+// Pixels of one tile, seeded like render_multithread
+std::vector<float> camera::render_tile(const hittable &world,
+                                       int index) const {
+  const tile t = tile_at(index);
+  seed_random(seed + t.index);
+
+  const size_t tile_pixels =
+      size_t(t.end_col - t.start_col) * (t.end_row - t.start_row);
+  std::vector<float> pixels;
+  pixels.reserve(tile_pixels * 3);
+  const color *colors = wavefront ? render_tile_wavefront(t, world)
+                                  : render_tile_paths(t, world);
+  for (size_t k = 0; k < tile_pixels; k++) {
+    pixels.push_back(float(colors[k].x()));
+    pixels.push_back(float(colors[k].y()));
+    pixels.push_back(float(colors[k].z()));
   }
+  return pixels;
+}
 
-  output_file << "P3\n" << image_width << ' ' << image_height << "\n255\n";
+// Copy the pixels of a tile into the image
+bool camera::set_tile(framebuffer &image, int index,
+                      const std::vector<float> &pixels) const {
+  if (index < 0 || index >= tile_count()) {
+    return false;
+  }
+  const tile t = tile_at(index);
+  if (pixels.size() !=
+      size_t(t.end_col - t.start_col) * (t.end_row - t.start_row) * 3) {
+    return false;
+  }
 
-  // Wait for threads to finish
-  for (int t = 0; t < num_threads; t++) {
-    threads[t].join();
+  size_t k = 0;
+  for (int j = t.start_row; j < t.end_row; j++) {
+    for (int i = t.start_col; i < t.end_col; i++, k += 3) {
+      image.set(i, j, color(pixels[k], pixels[k + 1], pixels[k + 2]));
+    }
   }
+  return true;
+}
+
+// Multithreaded render function
+framebuffer camera::render_multithread(const hittable &world,
+                                       render_stats *stats) const {
+  const auto start_time = std::chrono::steady_clock::now();
+
+  // Pixels of the whole image, every tile writes only its own pixels
+  framebuffer image(image_width, image_height);
 
-  // Print the image data from the buffers
-  for (int t = 0; t < num_threads; t++) {
-    output_file << buffers[t];
+  // Render
+  for_each_tile("Tiles", [&](const tile &t) {
+    // Seed from the tile index, so the image does not depend on which thread
+    // rendered which tile
+    seed_random(seed + t.index);
+
+    const color *pixels = wavefront ? render_tile_wavefront(t, world)
+                                    : render_tile_paths(t, world);
+    size_t k = 0;
+    for (int j = t.start_row; j < t.end_row; j++) {
+      for (int i = t.start_col; i < t.end_col; i++) {
+        image.set(i, j, pixels[k++]);
+      }
+    }
+  }, stats);
+
+  if (stats != nullptr) {
+    stats->samples = uint64_t(samples_per_pixel) * image_width * image_height;
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start_time)
+                         .count();
   }
 
   std::clog << "\rDone.                 \n";
+  return image;
+}
+
+// Running estimate of one pixel in progressive rendering
+namespace {
+struct pixel_estimate {
+  color sum;                       // Sum of the sample colors
+  double luminance_sum = 0;        // Sum of the sample luminances
+  double luminance_square_sum = 0; // Sum of the squared sample luminances
+  int samples = 0;                 // Samples taken so far
+  bool converged = false;          // Stopped sampling
+
+  // Add a sample
+  void add(const color &sample) {
+    const double y = luminance(sample);
+    sum += sample;
+    luminance_sum += y;
+    luminance_square_sum += y * y;
+    samples++;
+  }
+
+  // Mean color of the samples
+  color mean() const { return sum / double(samples); }
+
+  // Standard error of the mean luminance
+  double standard_error() const {
+    const double mean_luminance = luminance_sum / samples;
+    const double variance =
+        std::max(0.0, luminance_square_sum / samples -
+                          mean_luminance * mean_luminance);
+    return std::sqrt(variance / samples);
+  }
+};
+} // namespace
+
+// Progressive render function with adaptive sampling
+framebuffer camera::render_progressive(const hittable &world,
+                                       const pass_callback &on_pass,
+                                       render_stats *stats) const {
+  const auto start_time = std::chrono::steady_clock::now();
+
+  framebuffer image(image_width, image_height);
+  std::vector<pixel_estimate> estimates(size_t(image_width) * image_height);
+
+  // The first pass takes the minimum samples so every pixel has a variance
+  // estimate, later passes add samples_per_pass up to samples_per_pixel
+  int samples_taken = 0;
+  for (int pass = 0; samples_taken < samples_per_pixel; pass++) {
+    const int pass_samples =
+        std::min(pass == 0 ? min_samples_per_pixel : samples_per_pass,
+                 samples_per_pixel - samples_taken);
+    samples_taken += pass_samples;
+
+    for_each_tile("Pass " + std::to_string(pass + 1), [&](const tile &t) {
+      // Seed from the pass and tile index, as in render_multithread
+      seed_random(seed + (uint64_t(pass) << 32) + t.index);
+
+      for (int j = t.start_row; j < t.end_row; j++) {
+        for (int i = t.start_col; i < t.end_col; i++) {
+          auto &estimate = estimates[size_t(j) * image_width + i];
+          if (estimate.converged) {
+            continue;
+          }
+
+          for (int sample = 0; sample < pass_samples; sample++) {
+            estimate.add(ray_color(get_ray(i, j), world));
+          }
+          image.set(i, j, estimate.mean());
+
+          // Stop sampling once the pixel is known precisely enough
+          estimate.converged =
+              estimate.samples >= min_samples_per_pixel &&
+              estimate.standard_error() < noise_threshold;
+        }
+      }
+    }, stats);
+
+    // Count the pixels still sampling
+    size_t active_pixels = 0;
+    for (const auto &estimate : estimates) {
+      active_pixels += estimate.converged ? 0 : 1;
+    }
+    std::clog << ", pixels still sampling: " << active_pixels << '\n';
+
+    // Hand out the intermediate image
+    if (on_pass) {
+      on_pass(image, pass);
+    }
+
+    if (active_pixels == 0) {
+      break;
+    }
+  }
+
+  // Report the samples saved compared to a fixed sample count
+  size_t total_samples = 0;
+  for (const auto &estimate : estimates) {
+    total_samples += estimate.samples;
+  }
+  const double fixed_samples =
+      double(samples_per_pixel) * image_width * image_height;
+  std::clog << "Done. Samples: " << total_samples << " ("
+            << 100.0 * total_samples / fixed_samples
+            << "% of a fixed sample count)\n";
+
+  if (stats != nullptr) {
+    stats->samples = total_samples;
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start_time)
+                         .count();
+  }
+  return image;
+}
+
+// Whether [Render] adaptive selects progressive rendering
+bool camera::is_progressive() const { return adaptive; }
+
+// Rendered image size
+int camera::width() const { return image_width; }
+int camera::height() const { return image_height; }
+
+// Heatmap of the tile times
+framebuffer camera::tile_heatmap(const render_stats &stats) const {
+  framebuffer image(image_width, image_height);
+
+  const int tiles_x = tiles_per_row();
+  double slowest = 0;
+  for (const double seconds : stats.tile_seconds) {
+    slowest = std::max(slowest, seconds);
+  }
+  if (slowest <= 0) {
+    return image;
+  }
+
+  for (int j = 0; j < image_height; j++) {
+    for (int i = 0; i < image_width; i++) {
+      const size_t index = size_t(j / tile_size) * tiles_x + i / tile_size;
+      if (index >= stats.tile_seconds.size()) {
+        continue;
+      }
+
+      // Black to red, yellow and then white as the time grows
+      const double heat = 3 * stats.tile_seconds[index] / slowest;
+      const interval unit(0, 1);
+      image.set(i, j,
+                color(unit.clamp(heat), unit.clamp(heat - 1),
+                      unit.clamp(heat - 2)));
+    }
+  }
+  return image;
 }
 
 // Ray color for each pixel
-color camera::ray_color(const ray &r, const int depth,
-                        const hittable &world) const {
+color camera::ray_color(const ray &r, const hittable &world) const {
+  // Light gathered so far
+  color radiance(0, 0, 0);
+  // Product of the attenuations along the path so far
+  color throughput(1, 1, 1);
+  ray current = r;
+  // Density of the previous scatter choosing current, 0 after the camera and
+  // specular bounces, whose emitted light is then taken at full weight
+  real scatter_pdf = 0;
+
+  for (int depth = 0; depth < max_depth; depth++) {
+    rays_traced++;
+
+    // Check if the ray hits any object
+    hit_record record;
+    // Scattered rays start off the surface they leave (offset_ray_origin), so
+    // no minimum distance is needed to avoid self-intersection (shadow acne)
+    if (!world.hit(current, interval(0, infinity), record)) {
+      // Escaped, gather the light of the background
+      count_path(depth + 1);
+      return radiance + throughput * background_color(current);
+    }
+
+    if (!bounce(record, depth, world, current, throughput, radiance,
+                scatter_pdf)) {
+      count_path(depth + 1);
+      return radiance;
+    }
+  }
+
   // If we've exceeded the ray bounce limit, no more light is gathered.
-  if (depth <= 0) {
-    return color(0, 0, 0);
+  count_path(max_depth);
+  return radiance;
+}
+
+// Gather the light at the hit of current and scatter it into the next segment
+bool camera::bounce(const hit_record &record, int depth, const hittable &world,
+                    ray &current, color &throughput, color &radiance,
+                    real &scatter_pdf) const {
+  const bool sample_lights = lights != nullptr && !lights->empty();
+  const material &mat = *record.mat;
+
+  // Light emitted by the surface, weighted against the light sample of the
+  // previous bounce that could have found it too
+  const color emitted = mat.emitted(record);
+  if (emitted.x() > 0 || emitted.y() > 0 || emitted.z() > 0) {
+    real weight = 1;
+    if (scatter_pdf > 0 && sample_lights) {
+      const real light_pdf =
+          lights->pdf(current.origin(), unit_vector(current.direction()));
+      weight = power_heuristic(scatter_pdf, light_pdf);
+    }
+    radiance += weight * throughput * emitted;
   }
 
-  // If hits draw color map
+  // Next event estimation: light arriving directly from a sampled light,
+  // unless something lies in between
+  light_sample light;
+  if (sample_lights && !mat.is_specular() &&
+      lights->sample(record.point, light)) {
+    const color f = mat.bsdf_cosine(record, light.direction);
+    if (f.x() > 0 || f.y() > 0 || f.z() > 0) {
+      rays_traced++;
+      const ray shadow(
+          offset_ray_origin(record.point, record.normal, light.direction),
+          light.direction, current.time());
+      // Stop just short of the light surface, which must not occlude itself
+      if (!world.occluded(
+              shadow, interval(0, light.distance * (1 - shadow_ray_margin)))) {
+        const real weight = power_heuristic(
+            light.pdf, mat.scattering_pdf(record, light.direction));
+        radiance += (weight / light.pdf) * throughput * f * light.emission;
+      }
+    }
+  }
 
-  // Check if the ray hits the sphere
-  hit_record record;
-  // Use 0.001 as the minimum distance to avoid self-intersection (Causing
-  // shadow acne)
-  if (world.hit(r, interval(0.001, infinity), record)) {
-    // Create scattered ray and attenuation color
-    ray scattered;
-    color attenuation;
-    // And scatter the ray based on the material
-    const material &mat = *record.mat;
-    if (mat.scatter(r, record, attenuation, scattered)) {
-      // Return the color of the scattered ray
-      return attenuation * ray_color(scattered, depth - 1, world);
+  // Create scattered ray and attenuation color
+  ray scattered;
+  color attenuation;
+  // And scatter the ray based on the material
+  if (!mat.scatter(current, record, attenuation, scattered)) {
+    // If the ray is absorbed, no more light is gathered
+    return false;
+  }
+  throughput *= attenuation;
+  scatter_pdf =
+      sample_lights
+          ? mat.scattering_pdf(record, unit_vector(scattered.direction()))
+          : 0;
+
+  // Russian roulette: past roulette_depth, continue the path with
+  // probability p equal to its largest throughput component, and divide the
+  // survivors by p so the expected color stays the same (unbiased)
+  if (depth + 1 >= roulette_depth) {
+    const real p = std::min(
+        real(1), std::max({throughput.x(), throughput.y(), throughput.z()}));
+    if (random_double() >= p) {
+      return false;
     }
-    // If the ray is absorbed, return black
-    return color(0, 0, 0);
+    throughput /= p;
   }
 
-  // Otherwise, draw a gradient from blue to white
+  current = scattered;
+  return true;
+}
+
+// Follow every path of the batch to its end, one stage at a time
+void camera::trace_wavefront(wavefront_batch &batch, const hittable &world,
+                             color *pixel_sums) const {
+  for (int depth = 0; depth < max_depth && !batch.active.empty(); depth++) {
+    rays_traced += batch.active.size();
+
+    // Camera rays are coherent already, scattered ones are grouped again
+    if (sort_rays && depth > 0) {
+      batch.sort_active();
+    }
+
+    // Intersect stage, every active path at once
+    batch.intersect(world);
+
+    // Escaped paths gather the light of the background
+    for (const uint32_t k : batch.missed) {
+      wavefront_path &path = batch.paths[k];
+      count_path(depth + 1);
+      pixel_sums[path.pixel] += path.radiance +
+                                path.throughput * background_color(path.current);
+    }
+
+    // Scatter stage, one material at a time; the survivors, grouped by
+    // material, become the next active paths
+    for (const auto &bin : batch.bins) {
+      for (const uint32_t k : bin) {
+        wavefront_path &path = batch.paths[k];
+        if (bounce(batch.hits[k], depth, world, path.current, path.throughput,
+                   path.radiance, path.scatter_pdf)) {
+          batch.active.push_back(k);
+        } else {
+          count_path(depth + 1);
+          pixel_sums[path.pixel] += path.radiance;
+        }
+      }
+    }
+  }
+
+  // If we've exceeded the ray bounce limit, no more light is gathered
+  for (const uint32_t k : batch.active) {
+    count_path(max_depth);
+    pixel_sums[batch.paths[k].pixel] += batch.paths[k].radiance;
+  }
+  batch.active.clear();
+}
+
+// Average colors of the pixels of a tile, one path at a time
+const color *camera::render_tile_paths(const tile &t,
+                                       const hittable &world) const {
+  const size_t tile_pixels =
+      size_t(t.end_col - t.start_col) * (t.end_row - t.start_row);
+  arena &scratch = tile_scratch();
+  scratch.reset();
+  color *pixels = scratch.create_array<color>(tile_pixels);
+  size_t k = 0;
+  for (int j = t.start_row; j < t.end_row; j++) {
+    for (int i = t.start_col; i < t.end_col; i++) {
+      pixels[k++] = render_pixel(i, j, world);
+    }
+  }
+  return pixels;
+}
+
+// Average colors of the pixels of a tile, traced in wavefront batches
+const color *camera::render_tile_wavefront(const tile &t,
+                                           const hittable &world) const {
+  // Batches of every thread keep their memory from tile to tile
+  static thread_local wavefront_batch batch;
+
+  const int tile_width = t.end_col - t.start_col;
+  const size_t tile_pixels = size_t(tile_width) * (t.end_row - t.start_row);
+  arena &scratch = tile_scratch();
+  scratch.reset();
+  color *pixel_sums = scratch.create_array<color>(tile_pixels);
+
+  // As many samples of every pixel per batch as fit, the samples of one pixel
+  // next to each other
+  const int batch_samples = int(std::clamp(max_wavefront_paths / tile_pixels,
+                                           size_t(1),
+                                           size_t(samples_per_pixel)));
+  for (int first = 0; first < samples_per_pixel; first += batch_samples) {
+    const int samples = std::min(batch_samples, samples_per_pixel - first);
+    batch.clear();
+    for (int j = t.start_row; j < t.end_row; j++) {
+      for (int i = t.start_col; i < t.end_col; i++) {
+        const uint32_t pixel =
+            uint32_t(j - t.start_row) * tile_width + (i - t.start_col);
+        for (int sample = 0; sample < samples; sample++) {
+          batch.add(get_ray(i, j), pixel);
+        }
+      }
+    }
+    trace_wavefront(batch, world, pixel_sums);
+  }
+
+  for (size_t k = 0; k < tile_pixels; k++) {
+    pixel_sums[k] *= pixel_samples_scale;
+  }
+  return pixel_sums;
+}
+
+// Background color of a ray that hits nothing
+color camera::background_color(const ray &r) const {
+  // Draw a gradient from blue to white
 
   // Convert direction of ray to unit vector
   const vec3 unit_direction = unit_vector(r.direction());
   // Convert from range [-1, 1] to [0, 1] then calculate the color ratio
-  const auto blend_ratio = 0.5 * (unit_direction.y() - (-1.0));
+  const real blend_ratio = real(0.5) * (unit_direction.y() - real(-1));
 
   // Blue-to-white gradient
   const auto white = background_colors.at("white");
   const auto blue = background_colors.at("blue");
   return (1 - blend_ratio) * white + blend_ratio * blue;
-}
\ No newline at end of file
+}
@@ -0,0 +1,405 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <toml++/toml.hpp>
+
+#include "scene/camera.h"
+#include "scene/distributed.h"
+#include "scene/scene.h"
+#include "utils/framebuffer.h"
+#include "utils/socket.h"
+
+namespace {
+
+// Protocol
+//
+// worker -> coordinator: hello_message
+// For a config channel:
+//   coordinator -> worker: uint64_t size, then the config.toml text
+//   coordinator -> worker: uint64_t size, then the absolute directory of
+//                          config.toml, which relative OBJ paths start from
+// For a tile channel, until the coordinator sends no_more_tiles:
+//   coordinator -> worker: int32_t tile index
+//   worker -> coordinator: tile_result_header, then count floats
+
+// "RTW3" in little endian
+constexpr uint32_t protocol_magic = 0x33575452;
+
+// What a worker uses a connection for
+enum channel_kind : uint32_t { config_channel = 0, tile_channel = 1 };
+
+struct hello_message {
+  uint32_t magic;
+  uint32_t kind;
+};
+
+struct tile_result_header {
+  int32_t index;
+  uint32_t count; // Floats of linear RGB that follow
+  double seconds; // Time the worker spent rendering the tile
+};
+
+// Send a string as its uint64_t size followed by the characters
+bool send_string(const socket_handle &connection, const std::string &text) {
+  const uint64_t size = text.size();
+  return connection.send_all(&size, sizeof(size)) &&
+         connection.send_all(text.data(), text.size());
+}
+
+// Receive a string sent by send_string
+bool receive_string(const socket_handle &connection, std::string &text) {
+  uint64_t size = 0;
+  if (!connection.receive_all(&size, sizeof(size))) {
+    return false;
+  }
+  text.resize(size);
+  return connection.receive_all(text.data(), size);
+}
+
+// Tile index telling a worker to stop
+constexpr int32_t no_more_tiles = -1;
+
+// Tiles running this many times longer than the average are given to idle
+// workers as well, the first result wins
+constexpr double slow_tile_factor = 4.0;
+
+// Which tiles are waiting, running and done, shared by the connections
+class tile_scheduler {
+  using clock = std::chrono::steady_clock;
+
+  struct tile_state {
+    bool done = false;
+    int running = 0;           // Workers currently rendering the tile
+    clock::time_point started; // When the first of them started
+  };
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<tile_state> tiles;
+  std::deque<int> waiting;
+  int done_count = 0;
+  double done_seconds = 0; // Render time of the done tiles
+
+public:
+  explicit tile_scheduler(int count) : tiles(count) {
+    for (int index = 0; index < count; index++) {
+      waiting.push_back(index);
+    }
+  }
+
+  // Next tile to render, blocking until one is available
+  // Returns no_more_tiles once every tile is done
+  int next() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      if (done_count == int(tiles.size())) {
+        return no_more_tiles;
+      }
+
+      // Tiles nobody renders yet
+      while (!waiting.empty()) {
+        const int index = waiting.front();
+        waiting.pop_front();
+        auto &tile = tiles[index];
+        if (tile.done || tile.running > 0) {
+          continue;
+        }
+        tile.running = 1;
+        tile.started = clock::now();
+        return index;
+      }
+
+      // Otherwise help with the slowest tile if it runs far beyond average
+      if (done_count > 0) {
+        const double slow_seconds =
+            slow_tile_factor * done_seconds / done_count;
+        const auto now = clock::now();
+        int slowest = -1;
+        double slowest_seconds = slow_seconds;
+        for (int index = 0; index < int(tiles.size()); index++) {
+          const auto &tile = tiles[index];
+          if (tile.done || tile.running != 1) {
+            continue;
+          }
+          const double seconds =
+              std::chrono::duration<double>(now - tile.started).count();
+          if (seconds > slowest_seconds) {
+            slowest = index;
+            slowest_seconds = seconds;
+          }
+        }
+        if (slowest >= 0) {
+          tiles[slowest].running++;
+          return slowest;
+        }
+      }
+
+      // Check again once a tile changes or time passes
+      changed.wait_for(lock, std::chrono::milliseconds(100));
+    }
+  }
+
+  // A worker gave up on the tile, hand it out again unless done elsewhere
+  void release(int index) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto &tile = tiles[index];
+    tile.running--;
+    if (!tile.done && tile.running == 0) {
+      waiting.push_front(index);
+    }
+    changed.notify_all();
+  }
+
+  // A worker finished the tile
+  // Returns whether it is the first result of the tile
+  bool finish(int index) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto &tile = tiles[index];
+    tile.running--;
+    if (!tile.done) {
+      tile.done = true;
+      done_count++;
+      done_seconds +=
+          std::chrono::duration<double>(clock::now() - tile.started).count();
+      std::clog << "\rTiles: " << done_count << '/' << tiles.size()
+                << std::flush;
+      changed.notify_all();
+      return true;
+    }
+    changed.notify_all();
+    return false;
+  }
+
+  bool all_done() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return done_count == int(tiles.size());
+  }
+};
+
+// Serve one worker connection until the image is done or the worker fails
+void serve_connection(const socket_handle &connection,
+                      tile_scheduler &scheduler, const std::string &config_text,
+                      const std::string &directory, const camera &cam,
+                      framebuffer &image, std::mutex &image_mutex,
+                      render_stats *stats,
+                      std::chrono::steady_clock::time_point start) {
+  hello_message hello;
+  if (!connection.receive_all(&hello, sizeof(hello)) ||
+      hello.magic != protocol_magic) {
+    return;
+  }
+
+  if (hello.kind == config_channel) {
+    if (send_string(connection, config_text)) {
+      send_string(connection, directory);
+    }
+    return;
+  }
+  if (hello.kind != tile_channel) {
+    return;
+  }
+
+  // Results larger than the image are from a broken worker
+  const size_t max_floats = size_t(cam.width()) * cam.height() * 3;
+
+  while (true) {
+    const int32_t index = scheduler.next();
+    if (!connection.send_all(&index, sizeof(index))) {
+      if (index != no_more_tiles) {
+        scheduler.release(index);
+      }
+      return;
+    }
+    if (index == no_more_tiles) {
+      return;
+    }
+
+    tile_result_header header;
+    std::vector<float> pixels;
+    bool received = connection.receive_all(&header, sizeof(header)) &&
+                    header.index == index && header.count <= max_floats &&
+                    header.seconds >= 0;
+    if (received) {
+      pixels.resize(header.count);
+      received = connection.receive_all(pixels.data(),
+                                        pixels.size() * sizeof(float));
+    }
+    if (received) {
+      // Duplicated tiles write the same pixels, the seeds only depend on the
+      // tile index
+      const std::lock_guard<std::mutex> lock(image_mutex);
+      received = cam.set_tile(image, index, pixels);
+    }
+
+    if (!received) {
+      scheduler.release(index);
+      return;
+    }
+    if (scheduler.finish(index) && stats != nullptr) {
+      // Times of the first result, like the tiles of a local render
+      const std::lock_guard<std::mutex> lock(image_mutex);
+      stats->tile_seconds[index] = header.seconds;
+      if (stats->first_tile_seconds == 0) {
+        stats->first_tile_seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+      }
+    }
+  }
+}
+
+} // namespace
+
+// Render the image of cam with the workers connecting to address
+framebuffer render_coordinator(const std::string &address,
+                               const std::string &config_text,
+                               const std::string &directory,
+                               const camera &cam, render_stats *stats) {
+  const auto start = std::chrono::steady_clock::now();
+  const socket_handle listener = listen_socket(address);
+  std::clog << "Coordinator listening on " << address
+            << ", waiting for workers\n";
+
+  tile_scheduler scheduler(cam.tile_count());
+  framebuffer image(cam.width(), cam.height());
+  std::mutex image_mutex;
+  if (stats != nullptr) {
+    stats->tile_seconds.assign(cam.tile_count(), 0.0);
+  }
+
+  // One thread per connection, the sockets are kept to wake them up at the end
+  std::vector<std::shared_ptr<socket_handle>> connections;
+  std::vector<std::thread> threads;
+  while (!scheduler.all_done()) {
+    auto connection = accept_socket(listener, 100);
+    if (!connection.valid()) {
+      continue;
+    }
+    const auto shared =
+        std::make_shared<socket_handle>(std::move(connection));
+    connections.push_back(shared);
+    threads.emplace_back([&, shared]() {
+      serve_connection(*shared, scheduler, config_text, directory, cam, image,
+                       image_mutex, stats, start);
+    });
+  }
+
+  // Workers still rendering duplicated tiles are not waited for
+  for (const auto &connection : connections) {
+    connection->shutdown();
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  if (stats != nullptr) {
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+  std::clog << "\rDone.                 \n";
+  return image;
+}
+
+// Connect to the coordinator at address and render tiles until done
+bool run_worker(const std::string &address) {
+  // Fetch the config and its directory from the coordinator
+  std::string config_text;
+  std::string directory;
+  try {
+    const socket_handle connection = connect_socket(address);
+    const hello_message hello{protocol_magic, config_channel};
+    if (!connection.send_all(&hello, sizeof(hello)) ||
+        !receive_string(connection, config_text) ||
+        !receive_string(connection, directory)) {
+      std::cerr << "Error: Coordinator closed the connection: " << address
+                << "\n";
+      return false;
+    }
+  } catch (const std::exception &err) {
+    std::cerr << "Error: " << err.what() << "\n";
+    return false;
+  }
+
+  // Build the scene like a local render
+  toml::table config;
+  try {
+    config = toml::parse(config_text);
+  } catch (toml::parse_error &err) {
+    std::cerr << "Error loading config.toml from the coordinator\n";
+    std::cerr << err << "\n";
+    return false;
+  }
+  // Relative OBJ paths are resolved against the coordinator's directory, the
+  // working directory of the worker has nothing to do with the scene
+  if (directory.empty() || directory[0] != '/') {
+    std::cerr << "Error: Coordinator sent a relative config directory: "
+              << directory << "\n";
+    return false;
+  }
+  scene world;
+  if (!load_scene(config, world, directory)) {
+    return false;
+  }
+  const hittable &world_bvh = build_bvh(world);
+  camera cam(config);
+  cam.set_lights(&world.lights);
+
+  // One tile connection per render thread
+  std::mutex count_mutex;
+  int tiles_rendered = 0;
+  const auto render_tiles = [&]() -> void {
+    try {
+      const socket_handle connection = connect_socket(address);
+      const hello_message hello{protocol_magic, tile_channel};
+      if (!connection.send_all(&hello, sizeof(hello))) {
+        return;
+      }
+
+      int32_t index;
+      while (connection.receive_all(&index, sizeof(index)) &&
+             index != no_more_tiles) {
+        const auto tile_start = std::chrono::steady_clock::now();
+        const auto pixels = cam.render_tile(world_bvh, index);
+        const tile_result_header header{
+            index, uint32_t(pixels.size()),
+            std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          tile_start)
+                .count()};
+        if (!connection.send_all(&header, sizeof(header)) ||
+            !connection.send_all(pixels.data(),
+                                 pixels.size() * sizeof(float))) {
+          return;
+        }
+
+        const std::lock_guard<std::mutex> lock(count_mutex);
+        tiles_rendered++;
+      }
+    } catch (const std::exception &) {
+      // The coordinator is done or gone, the other threads end the same way
+    }
+  };
+
+  std::clog << "Worker rendering for " << address << " with "
+            << cam.thread_count() << " threads\n";
+  std::vector<std::thread> threads;
+  for (int t = 0; t < cam.thread_count(); t++) {
+    threads.emplace_back(render_tiles);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::clog << "Worker done, tiles rendered: " << tiles_rendered << "\n";
+  return true;
+}
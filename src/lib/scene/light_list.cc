@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "scene/light_list.h"
+#include "utils/color.h"
+#include "utils/rtweekend.h"
+#include "utils/vec3.h"
+
+namespace {
+
+// 1 - cos of the half angle of the cone a sphere of radius subtends at
+// squared distance distance_squared, in a form without cancellation for small
+// or distant spheres
+real cone_one_minus_cos(real radius, real distance_squared) {
+  const real sin_squared = radius * radius / distance_squared;
+  const real cos_max = std::sqrt(std::max(real(0), 1 - sin_squared));
+  return sin_squared / (1 + cos_max);
+}
+
+} // namespace
+
+// Add a spherical light
+void light_list::add_sphere(const point3 &center, real radius,
+                            const color &emission) {
+  lights.push_back(sphere_light{center, radius, emission});
+}
+
+bool light_list::empty() const { return lights.empty(); }
+
+size_t light_list::size() const { return lights.size(); }
+
+// Choose a light, then a direction within the cone it subtends
+bool light_list::sample(const point3 &origin, light_sample &sample) const {
+  const size_t index =
+      std::min(size_t(random_double() * lights.size()), lights.size() - 1);
+  const sphere_light &light = lights[index];
+
+  const vec3 to_center = light.center - origin;
+  const real distance_squared = to_center.length_squared();
+  if (distance_squared <= light.radius * light.radius) {
+    return false;
+  }
+
+  // Uniform direction in the cone around w, z = cos of the angle to w
+  const real one_minus_cos_max =
+      cone_one_minus_cos(light.radius, distance_squared);
+  const real one_minus_z = real(random_double()) * one_minus_cos_max;
+  const real z = 1 - one_minus_z;
+  const real sin_theta = std::sqrt(std::max(real(0), one_minus_z * (1 + z)));
+  const real phi = 2 * pi * real(random_double());
+
+  // Orthonormal basis around the direction to the center
+  const vec3 w = unit_vector(to_center);
+  const vec3 a =
+      std::fabs(w.x()) > real(0.9) ? vec3(0, 1, 0) : vec3(1, 0, 0);
+  const vec3 v = unit_vector(cross(w, a));
+  const vec3 u = cross(w, v);
+  sample.direction = unit_vector(std::cos(phi) * sin_theta * u +
+                                 std::sin(phi) * sin_theta * v + z * w);
+
+  // Nearer intersection with the sphere
+  const real b = dot(sample.direction, to_center);
+  const real discriminant =
+      b * b - (distance_squared - light.radius * light.radius);
+  sample.distance = b - std::sqrt(std::max(real(0), discriminant));
+  sample.emission = light.emission;
+  sample.pdf = pdf(origin, sample.direction);
+  return sample.pdf > 0;
+}
+
+// Solid angle density of sample choosing direction from origin
+real light_list::pdf(const point3 &origin, const vec3 &direction) const {
+  if (lights.empty()) {
+    return 0;
+  }
+
+  // Every light whose cone contains the direction could have produced it
+  real total = 0;
+  for (const sphere_light &light : lights) {
+    const vec3 to_center = light.center - origin;
+    const real distance_squared = to_center.length_squared();
+    const real radius_squared = light.radius * light.radius;
+    if (distance_squared <= radius_squared) {
+      continue;
+    }
+    const real b = dot(direction, to_center);
+    if (b <= 0 || b * b < distance_squared - radius_squared) {
+      continue;
+    }
+    total += 1 / (2 * pi * cone_one_minus_cos(light.radius, distance_squared));
+  }
+  return total / real(lights.size());
+}
@@ -0,0 +1,121 @@
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "hittables/triangle_mesh.h"
+#include "scene/obj_loader.h"
+#include "utils/vec3.h"
+
+namespace {
+
+// Skip spaces and tabs
+const char *skip_blanks(const char *p) {
+  while (*p == ' ' || *p == '\t') {
+    p++;
+  }
+  return p;
+}
+
+// Vertex index of a face corner "v", "v/vt", "v//vn" or "v/vt/vn", negative
+// indices count back from the last vertex read
+// Returns false if the corner is not a valid index
+bool parse_corner(const char *&p, size_t vertex_count, uint32_t &index) {
+  char *end;
+  errno = 0;
+  const long long value = std::strtoll(p, &end, 10);
+  if (end == p || errno != 0) {
+    return false;
+  }
+  p = end;
+  // Skip texture coordinate and normal indices
+  while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r') {
+    p++;
+  }
+
+  const long long resolved =
+      value < 0 ? (long long)vertex_count + value : value - 1;
+  if (resolved < 0 || resolved >= (long long)vertex_count) {
+    return false;
+  }
+  index = uint32_t(resolved);
+  return true;
+}
+
+} // namespace
+
+// Read the v and f lines of the OBJ file at path
+bool load_obj(const std::string &path, std::vector<point3> &vertices,
+              std::vector<triangle_mesh::triangle> &triangles) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Error: Cannot open OBJ file: " << path << "\n";
+    return false;
+  }
+
+  std::string line;
+  // Corners of the current face, reused between lines
+  std::vector<uint32_t> corners;
+  for (size_t line_number = 1; std::getline(file, line); line_number++) {
+    const char *p = skip_blanks(line.c_str());
+
+    // Vertex position, an optional w is ignored
+    if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+      p += 2;
+      double coordinates[3];
+      for (double &coordinate : coordinates) {
+        char *end;
+        coordinate = std::strtod(p, &end);
+        if (end == p) {
+          std::cerr << "Error: Invalid vertex in " << path << " line "
+                    << line_number << ": " << line << "\n";
+          return false;
+        }
+        // NaN or infinite coordinates would break the bounds of the BVH
+        if (!std::isfinite(coordinate)) {
+          std::cerr << "Error: Vertex coordinate is not finite in " << path
+                    << " line " << line_number << ": " << line << "\n";
+          return false;
+        }
+        p = end;
+      }
+      vertices.emplace_back(coordinates[0], coordinates[1], coordinates[2]);
+      continue;
+    }
+
+    // Face, split into a fan around its first corner
+    if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+      p = skip_blanks(p + 2);
+      corners.clear();
+      while (*p != '\0' && *p != '\r' && *p != '#') {
+        uint32_t index;
+        if (!parse_corner(p, vertices.size(), index)) {
+          std::cerr << "Error: Invalid face in " << path << " line "
+                    << line_number << ": " << line << "\n";
+          return false;
+        }
+        corners.push_back(index);
+        p = skip_blanks(p);
+      }
+      if (corners.size() < 3) {
+        std::cerr << "Error: Face with fewer than three vertices in " << path
+                  << " line " << line_number << "\n";
+        return false;
+      }
+      for (size_t k = 1; k + 1 < corners.size(); k++) {
+        triangles.push_back({corners[0], corners[k], corners[k + 1]});
+      }
+    }
+    // Every other statement (vt, vn, g, o, s, usemtl, comments) is ignored
+  }
+
+  if (file.bad()) {
+    std::cerr << "Error: Cannot read OBJ file: " << path << "\n";
+    return false;
+  }
+  return true;
+}
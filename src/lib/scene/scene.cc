@@ -0,0 +1,609 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <toml++/toml.hpp>
+
+#include "hittables/bvh.h"
+#include "hittables/instance.h"
+#include "hittables/material.h"
+#include "hittables/moving_sphere.h"
+#include "hittables/primitive_bvh.h"
+#include "hittables/sphere.h"
+#include "hittables/sphere_soup.h"
+#include "hittables/triangle_mesh.h"
+#include "scene/obj_loader.h"
+#include "scene/scene.h"
+#include "utils/color.h"
+#include "utils/transform.h"
+#include "utils/vec3.h"
+
+// Read the material of a sphere or mesh table (from string to material type),
+// table_kind names the table in the errors
+// Returns false and prints the error if the material is invalid
+static bool config_to_material(const toml::table &conf_object,
+                               const char *table_kind, material_desc &desc) {
+  // 检查材质配置是否完整
+  if (!conf_object.contains("material") ||
+      !conf_object["material"].is_string()) {
+    std::cerr << "Error: Each " << table_kind
+              << " must have a valid 'material' property of type string.\n";
+    return false;
+  }
+
+  // Lights have an emission instead of an albedo
+  if (conf_object["material"].as_string()->get() == "light") {
+    const auto emission_node = conf_object["emission"].as_array();
+    color emission;
+    if (!emission_node || !array_to_vec3(*emission_node, emission)) {
+      std::cerr << "Error: Light material must have a valid 'emission' "
+                   "property as an array of three finite numbers.\n";
+      return false;
+    }
+    if (emission.x() < 0 || emission.y() < 0 || emission.z() < 0) {
+      std::cerr << "Error: Light emission must be non-negative: " << emission
+                << "\n";
+      return false;
+    }
+    desc.type = material_kind::light;
+    desc.albedo[0] = emission.x();
+    desc.albedo[1] = emission.y();
+    desc.albedo[2] = emission.z();
+    desc.parameter = 0;
+    return true;
+  }
+
+  // 检查albedo是否存在且是数组
+  if (!conf_object.contains("albedo") || !conf_object["albedo"].is_array()) {
+    std::cerr << "Error: Each " << table_kind
+              << " must have a valid 'albedo' property as an array of three "
+                 "numbers.\n";
+    return false;
+  }
+
+  // 尝试解析albedo并检查其有效性
+  const color albedo(*conf_object["albedo"].as_array());
+  if (std::isnan(albedo.x()) || std::isinf(albedo.x()) ||
+      std::isnan(albedo.y()) || std::isinf(albedo.y()) ||
+      std::isnan(albedo.z()) || std::isinf(albedo.z())) {
+    std::cerr << "Error: Albedo contains invalid values: " << albedo << "\n";
+    return false;
+  }
+
+  // 检查albedo颜色值是否在合理范围内(0-1)
+  if (albedo.x() < 0 || albedo.x() > 1 || albedo.y() < 0 || albedo.y() > 1 ||
+      albedo.z() < 0 || albedo.z() > 1) {
+    std::cerr << "Warning: Albedo values should typically be in range [0,1]. "
+                 "Current values: "
+              << albedo << "\n";
+    // 这里只是警告，不返回false
+  }
+
+  desc.albedo[0] = albedo.x();
+  desc.albedo[1] = albedo.y();
+  desc.albedo[2] = albedo.z();
+
+  // Get the material type
+  const auto type_name = conf_object["material"].as_string()->get();
+
+  if (type_name == "lambertian") {
+    desc.type = material_kind::lambertian;
+    desc.parameter = 0;
+    return true;
+  }
+
+  if (type_name == "metal") {
+    // 检查fuzz参数
+    desc.type = material_kind::metal;
+    if (!conf_object.contains("fuzz")) {
+      desc.parameter = 0.0;
+      return true;
+    }
+
+    // 检查fuzz参数是否为浮点数
+    const auto fuzz_node = conf_object["fuzz"].as_floating_point();
+    if (!fuzz_node) {
+      std::cerr << "Error: Metal material 'fuzz' parameter must be a "
+                   "floating-point number.\n";
+      return false;
+    }
+
+    // 获取fuzz值
+    const double fuzz = fuzz_node->get();
+
+    if (std::isnan(fuzz) || std::isinf(fuzz) || fuzz < 0) {
+      std::cerr << "Error: Metal material 'fuzz' parameter must be a "
+                   "non-negative number.\n";
+      return false;
+    }
+
+    // fuzz值过大会导致渲染问题，通常应限制在0-1范围内
+    if (fuzz > 1) {
+      std::cerr << "Warning: Metal material 'fuzz' parameter should "
+                   "typically be in range [0,1]. Current value: "
+                << fuzz << "\n";
+    }
+    desc.parameter = fuzz;
+    return true;
+  }
+
+  if (type_name == "dielectric") {
+    // 检查refractive_index参数
+    desc.type = material_kind::dielectric;
+    if (!conf_object.contains("refractive_index")) {
+      desc.parameter = 1.0;
+      return true;
+    }
+
+    // 检查refractive_index参数是否为浮点数
+    const auto refractive_index_node =
+        conf_object["refractive_index"].as_floating_point();
+    if (!refractive_index_node) {
+      std::cerr << "Error: Dielectric material 'refractive_index' must be "
+                   "a floating-point number.\n";
+      return false;
+    }
+
+    // 获取refractive_index值
+    const double refractive_index = refractive_index_node->get();
+
+    if (std::isnan(refractive_index) || std::isinf(refractive_index) ||
+        refractive_index <= 0) {
+      std::cerr << "Error: Dielectric material 'refractive_index' must be "
+                   "a positive number.\n";
+      return false;
+    }
+    desc.parameter = refractive_index;
+    return true;
+  }
+
+  // Invalid type
+  std::cerr << "Error: Unknown material type: '" << type_name
+            << "'. Supported types: lambertian, metal, dielectric, light.\n";
+  return false;
+}
+
+// Index of every distinct material, so spheres with equal material
+// parameters share a single material
+using material_index_map =
+    std::map<std::tuple<material_kind, double, double, double, double>,
+             uint32_t>;
+
+// Append the spheres of an array of sphere tables to desc, merging equal
+// materials
+// Returns false and prints the error if any sphere is invalid
+static bool load_sphere_tables(const toml::array &config_spheres,
+                               material_index_map &material_indices,
+                               scene_desc &desc) {
+  desc.spheres.reserve(desc.spheres.size() + config_spheres.size());
+
+  // For each spheres in the list
+  for (const auto &s : config_spheres) {
+    // Convert s to table
+    const auto s_table_node = s.as_table();
+
+    // Check if the node is valid
+    if (!s_table_node) {
+      std::cerr << "Error: Sphere configuration is not a valid table.\n";
+      return false;
+    }
+
+    // Refer to the table, copying it would copy every node
+    const auto &s_table = *s_table_node;
+
+    // Read the material
+    material_desc mat;
+    // Check if the material is valid
+    if (!config_to_material(s_table, "sphere", mat)) {
+      if (const auto type_node = s_table["material"].as_string()) {
+        std::cerr << "Invalid material type: " << type_node->get() << "\n";
+      }
+      return false;
+    }
+
+    // Get the center and radius of the sphere
+    const auto center_node = s_table["center"].as_array();
+    point3 center;
+    if (!center_node || !array_to_vec3(*center_node, center)) {
+      std::cerr << "Error: Sphere center must be an array of three finite "
+                   "numbers.\n";
+      return false;
+    }
+
+    // Get radius node
+    const auto radius_node = s_table["radius"].as_floating_point();
+    if (!radius_node) {
+      std::cerr << "Error: Sphere radius must be a floating-point number.\n";
+      return false;
+    }
+
+    const auto radius = radius_node->get();
+
+    // 检查半径是否为正数且不是NaN或无穷大
+    if (radius <= 0 || std::isnan(radius) || std::isinf(radius)) {
+      std::cerr << "Invalid sphere radius: " << radius
+                << ". Radius must be a positive number.\n";
+      return false;
+    }
+
+    // Moving spheres also give their center at time 1 (optional)
+    point3 center1 = center;
+    if (s_table.contains("center1")) {
+      const auto center1_node = s_table["center1"].as_array();
+      if (!center1_node || !array_to_vec3(*center1_node, center1)) {
+        std::cerr << "Error: Sphere center1 must be an array of three finite "
+                     "numbers.\n";
+        return false;
+      }
+    }
+
+    // Reuse an equal material, or add a new one
+    const auto inserted = material_indices.emplace(
+        std::make_tuple(mat.type, mat.albedo[0], mat.albedo[1], mat.albedo[2],
+                        mat.parameter),
+        uint32_t(desc.materials.size()));
+    if (inserted.second) {
+      desc.materials.push_back(mat);
+    }
+
+    // Add sphere to the scene
+    sphere_desc sph;
+    sph.center[0] = center.x();
+    sph.center[1] = center.y();
+    sph.center[2] = center.z();
+    sph.radius = radius;
+    const vec3 motion = center1 - center;
+    sph.motion[0] = motion.x();
+    sph.motion[1] = motion.y();
+    sph.motion[2] = motion.z();
+    sph.material = inserted.first->second;
+    desc.spheres.push_back(sph);
+  }
+
+  return true;
+}
+
+// Read the [[Sphere]] tables of the config, merging equal materials
+bool load_scene_desc(const toml::table &config, scene_desc &desc) {
+  desc.materials.clear();
+  desc.spheres.clear();
+
+  // Create a sphere object list
+  const auto config_spheres_node = config["Sphere"].as_array();
+  if (!config_spheres_node) {
+    // Scenes made only of meshes or instances need no [[Sphere]] tables
+    if (config.contains("Mesh") || config.contains("Instance")) {
+      return true;
+    }
+    std::cerr << "Error: config.toml must contain [[Sphere]] tables.\n";
+    return false;
+  }
+
+  material_index_map material_indices;
+  return load_sphere_tables(*config_spheres_node, material_indices, desc);
+}
+
+// Create the material of its parameters
+static material make_material(const material_desc &desc) {
+  const color albedo(desc.albedo[0], desc.albedo[1], desc.albedo[2]);
+  switch (desc.type) {
+  case material_kind::metal:
+    return metal(albedo, desc.parameter);
+  case material_kind::dielectric:
+    return dielectric(desc.parameter);
+  case material_kind::light:
+    return diffuse_light(albedo);
+  case material_kind::lambertian:
+  case material_kind::count:
+    break;
+  }
+  return lambertian(albedo);
+}
+
+// Scenes hold these by the million, so the arena must not record a
+// destructor call for every one of them
+static_assert(std::is_trivially_destructible_v<material> &&
+                  std::is_trivially_destructible_v<sphere> &&
+                  std::is_trivially_destructible_v<moving_sphere> &&
+                  std::is_trivially_destructible_v<sphere_soup> &&
+                  std::is_trivially_destructible_v<bvh_node> &&
+                  std::is_trivially_destructible_v<instance>,
+              "primitives and BVH nodes must be trivially destructible");
+
+// Create the materials of the parameter array in the memory of the scene
+static std::vector<const material *>
+create_materials(const material_desc *materials, size_t material_count,
+                 scene &world) {
+  std::vector<const material *> created;
+  created.reserve(material_count);
+  for (size_t index = 0; index < material_count; index++) {
+    created.push_back(
+        world.memory.create<material>(make_material(materials[index])));
+  }
+  return created;
+}
+
+// Add the spheres of the parameter array to list, in the memory of the scene,
+// their material indices referring to materials
+// The still spheres are created as one array, in list order, which a
+// sphere-only scene's primitive_bvh then reorders in place
+static void add_spheres(const sphere_desc *spheres, size_t sphere_count,
+                        const std::vector<const material *> &materials,
+                        scene &world, hittable_list &list) {
+  size_t still_count = 0;
+  for (size_t index = 0; index < sphere_count; index++) {
+    const auto &motion = spheres[index].motion;
+    still_count += vec3(motion[0], motion[1], motion[2]).near_zero();
+  }
+  sphere *still = world.memory.create_array<sphere>(still_count);
+
+  list.objects.reserve(list.objects.size() + sphere_count);
+  for (size_t index = 0; index < sphere_count; index++) {
+    const auto &s = spheres[index];
+    const point3 center(s.center[0], s.center[1], s.center[2]);
+    const vec3 motion(s.motion[0], s.motion[1], s.motion[2]);
+    const material *mat = materials[s.material];
+    // Still spheres stay plain spheres, so the BVH can pack them into soups
+    if (motion.near_zero()) {
+      *still = sphere(center, s.radius, mat);
+      list.add(still++);
+    } else {
+      list.add(world.memory.create<moving_sphere>(center, center + motion,
+                                                  s.radius, mat));
+    }
+  }
+}
+
+// Create the materials and spheres of the parameter arrays
+void build_scene(const material_desc *materials, size_t material_count,
+                 const sphere_desc *spheres, size_t sphere_count,
+                 scene &world) {
+  add_spheres(spheres, sphere_count,
+              create_materials(materials, material_count, world), world,
+              world.objects);
+
+  // Still light spheres are also sampled directly, moving ones are only found
+  // by scattered rays
+  for (size_t index = 0; index < sphere_count; index++) {
+    const auto &s = spheres[index];
+    const auto &mat = materials[s.material];
+    const vec3 motion(s.motion[0], s.motion[1], s.motion[2]);
+    if (mat.type == material_kind::light && motion.near_zero()) {
+      world.lights.add_sphere(point3(s.center[0], s.center[1], s.center[2]),
+                              s.radius,
+                              color(mat.albedo[0], mat.albedo[1],
+                                    mat.albedo[2]));
+    }
+  }
+}
+
+// Read table[key] as an array of three numbers, value keeps its default when
+// the key is absent
+// Returns false and prints the error if the value is invalid
+static bool config_to_vec3(const toml::table &table, const char *key,
+                           vec3 &value) {
+  if (!table.contains(key)) {
+    return true;
+  }
+  const auto array_node = table[key].as_array();
+  if (!array_node || !array_to_vec3(*array_node, value)) {
+    std::cerr << "Error: Instance '" << key
+              << "' must be an array of three finite numbers.\n";
+    return false;
+  }
+  return true;
+}
+
+// Add a triangle mesh to list for every table of an array of mesh tables,
+// reading their OBJ files relative to directory
+// Returns false and prints the error if any mesh is invalid
+static bool load_mesh_tables(const toml::array &config_meshes,
+                             const std::string &directory, scene &world,
+                             hittable_list &list) {
+  for (const auto &m : config_meshes) {
+    const auto m_table_node = m.as_table();
+    if (!m_table_node) {
+      std::cerr << "Error: Mesh configuration is not a valid table.\n";
+      return false;
+    }
+    const auto &m_table = *m_table_node;
+
+    const auto file_node = m_table["file"].as_string();
+    if (!file_node) {
+      std::cerr << "Error: Each mesh must have a valid 'file' property of "
+                   "type string.\n";
+      return false;
+    }
+    const std::string &file = file_node->get();
+    const std::string path =
+        !file.empty() && file[0] == '/' ? file : directory + "/" + file;
+
+    material_desc mat;
+    if (!config_to_material(m_table, "mesh", mat)) {
+      return false;
+    }
+
+    std::vector<point3> vertices;
+    std::vector<triangle_mesh::triangle> triangles;
+    if (!load_obj(path, vertices, triangles)) {
+      return false;
+    }
+    if (triangles.empty()) {
+      std::cerr << "Error: OBJ file has no faces: " << path << "\n";
+      return false;
+    }
+    std::clog << "Loaded mesh: " << path << " (" << vertices.size()
+              << " vertices, " << triangles.size() << " triangles)\n";
+
+    list.add(world.memory.create<triangle_mesh>(
+        std::move(vertices), std::move(triangles),
+        world.memory.create<material>(make_material(mat))));
+  }
+  return true;
+}
+
+// Create the meshes of the [[Mesh]] tables, the shared objects of the
+// [[Object]] tables and the [[Instance]] tables placing them
+bool load_objects(const toml::table &config, const std::string &directory,
+                  scene &world) {
+  if (const auto config_meshes_node = config["Mesh"].as_array()) {
+    if (!load_mesh_tables(*config_meshes_node, directory, world,
+                          world.objects)) {
+      return false;
+    }
+  }
+
+  // Shared objects by name
+  std::map<std::string, const hittable *> objects_by_name;
+
+  if (const auto config_objects_node = config["Object"].as_array()) {
+    for (const auto &o : *config_objects_node) {
+      const auto o_table_node = o.as_table();
+      if (!o_table_node) {
+        std::cerr << "Error: Object configuration is not a valid table.\n";
+        return false;
+      }
+      const auto &o_table = *o_table_node;
+
+      const auto name_node = o_table["name"].as_string();
+      if (!name_node) {
+        std::cerr << "Error: Each object must have a valid 'name' property "
+                     "of type string.\n";
+        return false;
+      }
+      const std::string &name = name_node->get();
+
+      const auto spheres_node = o_table["Sphere"].as_array();
+      const auto meshes_node = o_table["Mesh"].as_array();
+      if ((!spheres_node || spheres_node->empty()) &&
+          (!meshes_node || meshes_node->empty())) {
+        std::cerr << "Error: Object '" << name
+                  << "' must contain [[Object.Sphere]] or [[Object.Mesh]] "
+                     "tables.\n";
+        return false;
+      }
+
+      // Spheres, meshes and materials of the object, created once however
+      // many instances reference it
+      hittable_list object_list;
+      if (spheres_node) {
+        scene_desc desc;
+        material_index_map material_indices;
+        if (!load_sphere_tables(*spheres_node, material_indices, desc)) {
+          return false;
+        }
+        add_spheres(desc.spheres.data(), desc.spheres.size(),
+                    create_materials(desc.materials.data(),
+                                     desc.materials.size(), world),
+                    world, object_list);
+      }
+      if (meshes_node &&
+          !load_mesh_tables(*meshes_node, directory, world, object_list)) {
+        return false;
+      }
+      const hittable *shared_object =
+          world.memory.create<bvh_node>(world.memory, std::move(object_list));
+
+      if (!objects_by_name.emplace(name, shared_object).second) {
+        std::cerr << "Error: Duplicate object name: '" << name << "'.\n";
+        return false;
+      }
+    }
+  }
+
+  const auto config_instances_node = config["Instance"].as_array();
+  if (!config_instances_node) {
+    return true;
+  }
+  for (const auto &i : *config_instances_node) {
+    const auto i_table_node = i.as_table();
+    if (!i_table_node) {
+      std::cerr << "Error: Instance configuration is not a valid table.\n";
+      return false;
+    }
+    const auto &i_table = *i_table_node;
+
+    const auto object_node = i_table["object"].as_string();
+    if (!object_node) {
+      std::cerr << "Error: Each instance must have a valid 'object' property "
+                   "of type string.\n";
+      return false;
+    }
+    const auto object = objects_by_name.find(object_node->get());
+    if (object == objects_by_name.end()) {
+      std::cerr << "Error: Unknown object: '" << object_node->get() << "'.\n";
+      return false;
+    }
+
+    // Scale, then rotate (degrees about x, y, z), then translate
+    vec3 translate(0, 0, 0), rotate(0, 0, 0), scale(1, 1, 1);
+    if (const auto uniform_scale_node = i_table["scale"].value<double>()) {
+      scale = vec3(*uniform_scale_node, *uniform_scale_node,
+                   *uniform_scale_node);
+    } else if (!config_to_vec3(i_table, "scale", scale)) {
+      return false;
+    }
+    if (!config_to_vec3(i_table, "translate", translate) ||
+        !config_to_vec3(i_table, "rotate", rotate)) {
+      return false;
+    }
+    if (scale.x() == 0 || scale.y() == 0 || scale.z() == 0) {
+      std::cerr << "Error: Instance scale must not be zero: " << scale
+                << "\n";
+      return false;
+    }
+
+    world.objects.add(world.memory.create<instance>(
+        object->second, affine_transform::translation(translate) *
+                            affine_transform::rotation(rotate) *
+                            affine_transform::scaling(scale)));
+  }
+
+  return true;
+}
+
+// Load the scene tables of the config into the scene
+bool load_scene(const toml::table &config, scene &world,
+                const std::string &directory) {
+  scene_desc desc;
+  if (!load_scene_desc(config, desc)) {
+    return false;
+  }
+  build_scene(desc.materials.data(), desc.materials.size(),
+              desc.spheres.data(), desc.spheres.size(), world);
+  return load_objects(config, directory, world);
+}
+
+// Bounding volume hierarchy over the objects of the world
+const hittable &build_bvh(scene &world) {
+  if (const auto spheres = make_primitive_bvh<sphere>(world.memory,
+                                                      world.objects)) {
+    std::clog << "Sphere-only scene: " << spheres->size()
+              << " spheres in one flat BVH\n";
+    // The spheres were reordered, the list no longer refers to them
+    world.objects.clear();
+    return *spheres;
+  }
+
+  // Spheres of other scenes are grouped into sphere soup leaves, which beat
+  // single spheres behind virtual calls but not the flat BVH above
+  const size_t sphere_count = std::count_if(
+      world.objects.objects.begin(), world.objects.objects.end(),
+      [](const hittable *object) {
+        return dynamic_cast<const sphere *>(object) != nullptr;
+      });
+  if (sphere_count > 1) {
+    std::clog << "Sphere soup leaves, instruction set: "
+              << sphere_soup::simd_name() << "\n";
+  }
+  return *world.memory.create<bvh_node>(world.memory,
+                                        std::move(world.objects));
+}
@@ -0,0 +1,423 @@
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SCENE_CACHE_MMAP 1
+#endif
+
+#include <toml++/toml.hpp>
+
+#include "scene/scene.h"
+#include "scene/scene_cache.h"
+
+namespace {
+
+// Bumped whenever the layout changes, older caches are then rebuilt
+constexpr uint32_t scene_cache_version = 2;
+constexpr char scene_cache_magic[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', 0};
+
+// Start of the cache file
+struct scene_cache_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t material_count;
+  uint64_t sphere_count;
+  uint64_t source_hash;
+};
+static_assert(sizeof(scene_cache_header) == 32,
+              "scene_cache_header is stored as is in the scene cache");
+
+// Read-only view of a whole file, memory mapped where the platform allows it
+class mapped_file {
+  const unsigned char *bytes = nullptr;
+  size_t length = 0;
+#ifdef SCENE_CACHE_MMAP
+  void *mapping = nullptr;
+#else
+  std::vector<unsigned char> buffer;
+#endif
+
+public:
+  // Map the file at path, is_open() tells whether it succeeded
+  explicit mapped_file(const std::string &path) {
+#ifdef SCENE_CACHE_MMAP
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+      void *const address =
+          mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address != MAP_FAILED) {
+        mapping = address;
+        bytes = static_cast<const unsigned char *>(address);
+        length = size_t(info.st_size);
+      }
+    }
+    // The mapping stays valid after closing the descriptor
+    close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      return;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    bytes = buffer.data();
+    length = buffer.size();
+#endif
+  }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  ~mapped_file() {
+#ifdef SCENE_CACHE_MMAP
+    if (mapping != nullptr) {
+      munmap(mapping, length);
+    }
+#endif
+  }
+
+  bool is_open() const { return bytes != nullptr; }
+  const unsigned char *data() const { return bytes; }
+  size_t size() const { return length; }
+};
+
+// Whether count values are all finite
+bool all_finite(const double *values, size_t count) {
+  for (size_t k = 0; k < count; k++) {
+    if (!std::isfinite(values[k])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whether the material passes the checks of the [[Sphere]] table parsing
+bool valid_material(const material_desc &desc) {
+  if (!all_finite(desc.albedo, 3) || !std::isfinite(desc.parameter)) {
+    return false;
+  }
+  switch (desc.type) {
+  case material_kind::lambertian:
+    return desc.parameter == 0;
+  case material_kind::metal:
+    return desc.parameter >= 0; // Fuzz
+  case material_kind::dielectric:
+    return desc.parameter > 0; // Refractive index
+  case material_kind::light:
+    // Emission
+    return desc.albedo[0] >= 0 && desc.albedo[1] >= 0 &&
+           desc.albedo[2] >= 0 && desc.parameter == 0;
+  case material_kind::count:
+    break;
+  }
+  return false;
+}
+
+// Whether the sphere passes the checks of the [[Sphere]] table parsing and
+// refers to one of material_count materials
+bool valid_sphere(const sphere_desc &desc, size_t material_count) {
+  return all_finite(desc.center, 3) && all_finite(desc.motion, 3) &&
+         std::isfinite(desc.radius) && desc.radius > 0 &&
+         desc.material < material_count;
+}
+
+// Whether name is a bare TOML key: letters, digits, '_' and '-'
+bool is_bare_key(std::string_view name) {
+  if (name.empty()) {
+    return false;
+  }
+  for (const char c : name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Split the table header at the start of line, "[a.b]" or "[[a.b]]" with an
+// optional comment, into its keys
+// Returns false unless it is a header of bare keys
+bool parse_table_header(std::string_view line, bool &array_of_tables,
+                        std::vector<std::string_view> &keys) {
+  // Drop the comment and trailing white space
+  line = line.substr(0, line.find('#'));
+  const size_t last = line.find_last_not_of(" \t\r\n");
+  line = line.substr(0, last == std::string_view::npos ? 0 : last + 1);
+
+  array_of_tables = line.rfind("[[", 0) == 0;
+  const size_t brackets = array_of_tables ? 2 : 1;
+  if (line.size() < 2 * brackets ||
+      line.substr(line.size() - brackets) !=
+          std::string_view("]]").substr(0, brackets)) {
+    return false;
+  }
+  std::string_view name = line.substr(brackets, line.size() - 2 * brackets);
+
+  keys.clear();
+  while (true) {
+    const size_t dot = name.find('.');
+    std::string_view key = name.substr(0, dot);
+    const size_t key_first = key.find_first_not_of(" \t");
+    const size_t key_last = key.find_last_not_of(" \t");
+    key = key_first == std::string_view::npos
+              ? std::string_view()
+              : key.substr(key_first, key_last - key_first + 1);
+    if (!is_bare_key(key)) {
+      return false;
+    }
+    keys.push_back(key);
+    if (dot == std::string_view::npos) {
+      return true;
+    }
+    name.remove_prefix(dot + 1);
+  }
+}
+
+// Add the brackets the line opens outside of strings and comments to depth,
+// so that the lines of a multi-line array are not taken for table headers
+// Returns false for multi-line strings and strings left open
+bool track_array_depth(std::string_view line, int &depth) {
+  for (size_t k = 0; k < line.size(); k++) {
+    const char c = line[k];
+    if (c == '#') {
+      break;
+    }
+    if (c == '"' || c == '\'') {
+      const std::string_view multi_line = c == '"' ? "\"\"\"" : "'''";
+      if (line.substr(k, 3) == multi_line) {
+        return false;
+      }
+      // Basic strings have escapes, literal strings do not
+      k++;
+      while (k < line.size() && line[k] != c) {
+        k += c == '"' && line[k] == '\\' ? 2 : 1;
+      }
+      if (k >= line.size()) {
+        return false;
+      }
+    } else if (c == '[') {
+      depth++;
+    } else if (c == ']') {
+      depth--;
+    }
+  }
+  return depth >= 0;
+}
+
+} // namespace
+
+// Hash of the config text (64-bit FNV-1a)
+uint64_t scene_source_hash(std::string_view text) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const char c : text) {
+    hash ^= uint64_t(static_cast<unsigned char>(c));
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// The config text without its [[Sphere]] tables
+bool strip_sphere_tables(std::string_view text, std::string &stripped) {
+  stripped.clear();
+  bool in_sphere_table = false;
+  bool in_root_table = true;
+  int array_depth = 0; // Brackets of a multi-line array still open
+
+  while (!text.empty()) {
+    const size_t line_end = text.find('\n');
+    const size_t line_length =
+        line_end == std::string_view::npos ? text.size() : line_end + 1;
+    const std::string_view line = text.substr(0, line_length);
+    text.remove_prefix(line_length);
+
+    // A table header ends the previous table, keys can not follow a table
+    // outside of it
+    const size_t first = line.find_first_not_of(" \t\r\n");
+    if (array_depth == 0 && first != std::string_view::npos &&
+        line[first] == '[') {
+      bool array_of_tables = false;
+      std::vector<std::string_view> keys;
+      if (!parse_table_header(line.substr(first), array_of_tables, keys)) {
+        return false;
+      }
+      // Only whole [[Sphere]] tables can be left out
+      if (keys.front() == "Sphere" &&
+          (!array_of_tables || keys.size() != 1)) {
+        return false;
+      }
+      in_sphere_table = keys.front() == "Sphere";
+      in_root_table = false;
+    } else if (array_depth == 0 && first != std::string_view::npos &&
+               line[first] != '#') {
+      // Spheres given by keys of the root table are not handled here
+      const std::string_view key = line.substr(first);
+      if (in_root_table &&
+          (key[0] == '"' || key[0] == '\'' ||
+           (key.rfind("Sphere", 0) == 0 &&
+            key.find_first_of(" \t=.") == sizeof("Sphere") - 1))) {
+        return false;
+      }
+      if (!track_array_depth(line, array_depth)) {
+        return false;
+      }
+    } else if (array_depth > 0 && !track_array_depth(line, array_depth)) {
+      return false;
+    }
+
+    if (!in_sphere_table) {
+      stripped += line;
+    }
+  }
+  return array_depth == 0;
+}
+
+// Build the scene of the cache at path
+bool load_scene_cache(const std::string &path, uint64_t source_hash,
+                      scene &world) {
+  const mapped_file file(path);
+  if (!file.is_open() || file.size() < sizeof(scene_cache_header)) {
+    return false;
+  }
+
+  scene_cache_header header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, scene_cache_magic, sizeof(header.magic)) !=
+          0 ||
+      header.version != scene_cache_version ||
+      header.source_hash != source_hash) {
+    return false;
+  }
+
+  // The arrays follow the header directly and fill the rest of the file
+  const size_t available = file.size() - sizeof(header);
+  if (header.material_count > available / sizeof(material_desc) ||
+      header.sphere_count > available / sizeof(sphere_desc)) {
+    return false;
+  }
+  const size_t materials_size = header.material_count * sizeof(material_desc);
+  const size_t spheres_size = header.sphere_count * sizeof(sphere_desc);
+  if (materials_size + spheres_size != available) {
+    return false;
+  }
+
+  // The mapping is page aligned and the arrays 8 byte aligned, so the
+  // parameters are read in place
+  const auto materials = reinterpret_cast<const material_desc *>(
+      file.data() + sizeof(header));
+  const auto spheres = reinterpret_cast<const sphere_desc *>(
+      file.data() + sizeof(header) + materials_size);
+
+  // A damaged cache must not build a scene the config could not describe
+  for (size_t index = 0; index < header.material_count; index++) {
+    if (!valid_material(materials[index])) {
+      return false;
+    }
+  }
+  for (size_t index = 0; index < header.sphere_count; index++) {
+    if (!valid_sphere(spheres[index], header.material_count)) {
+      return false;
+    }
+  }
+
+  build_scene(materials, header.material_count, spheres, header.sphere_count,
+              world);
+  return true;
+}
+
+// Write the scene parameters to the cache at path
+bool save_scene_cache(const std::string &path, uint64_t source_hash,
+                      const scene_desc &desc) {
+  scene_cache_header header;
+  std::memcpy(header.magic, scene_cache_magic, sizeof(header.magic));
+  header.version = scene_cache_version;
+  header.material_count = uint32_t(desc.materials.size());
+  header.sphere_count = desc.spheres.size();
+  header.source_hash = source_hash;
+
+  // Write to a temporary file first, so an interrupted write never leaves a
+  // cache that looks valid
+  const std::string temporary_path = path + ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      std::cerr << "Warning: Cannot write scene cache: " << path << "\n";
+      return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(desc.materials.data()),
+               std::streamsize(desc.materials.size() * sizeof(material_desc)));
+    file.write(reinterpret_cast<const char *>(desc.spheres.data()),
+               std::streamsize(desc.spheres.size() * sizeof(sphere_desc)));
+    if (!file) {
+      std::cerr << "Warning: Cannot write scene cache: " << path << "\n";
+      return false;
+    }
+  }
+
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    std::remove(temporary_path.c_str());
+    std::cerr << "Warning: Cannot write scene cache: " << path << "\n";
+    return false;
+  }
+  return true;
+}
+
+// Read the config and load its scene, from the cache when it is up to date
+bool load_scene_cached(const std::string &config_path,
+                       const std::string &cache_path, toml::table &config,
+                       scene &world) {
+  std::ifstream config_file(config_path, std::ios::binary);
+  if (!config_file) {
+    std::cerr << "Error: Cannot open config file: " << config_path << "\n";
+    return false;
+  }
+  std::ostringstream config_text;
+  config_text << config_file.rdbuf();
+  const std::string text = config_text.str();
+  const uint64_t source_hash = scene_source_hash(text);
+  // OBJ files of meshes are relative to the config
+  const size_t slash = config_path.rfind('/');
+  const std::string directory =
+      slash == std::string::npos ? "." : config_path.substr(0, slash);
+
+  // Up to date cache, only the settings outside [[Sphere]] need parsing
+  // unless the config has more than the line scan recognizes
+  if (!cache_path.empty() && load_scene_cache(cache_path, source_hash, world)) {
+    std::string stripped;
+    config = toml::parse(strip_sphere_tables(text, stripped) ? stripped : text);
+    std::clog << "Loaded scene cache: " << cache_path << "\n";
+    return load_objects(config, directory, world);
+  }
+
+  config = toml::parse(text);
+  scene_desc desc;
+  if (!load_scene_desc(config, desc)) {
+    return false;
+  }
+  build_scene(desc.materials.data(), desc.materials.size(),
+              desc.spheres.data(), desc.spheres.size(), world);
+
+  if (!cache_path.empty() && save_scene_cache(cache_path, source_hash, desc)) {
+    std::clog << "Wrote scene cache: " << cache_path << "\n";
+  }
+  return load_objects(config, directory, world);
+}
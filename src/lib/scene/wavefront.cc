@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "hittables/hittable.h"
+#include "hittables/material.h"
+#include "scene/wavefront.h"
+#include "utils/aabb.h"
+#include "utils/interval.h"
+#include "utils/rtweekend.h"
+
+namespace {
+
+// Cells of the origin grid per axis are 2^origin_grid_bits
+constexpr int origin_grid_bits = 3;
+constexpr uint32_t origin_grid_cells = uint32_t(1) << origin_grid_bits;
+
+// Spread the low origin_grid_bits bits of v two bits apart, for interleaving
+// the cell coordinates into a Morton code
+uint32_t spread_bits(uint32_t v) {
+  v = (v | (v << 4)) & 0x0C3;
+  v = (v | (v << 2)) & 0x249;
+  return v;
+}
+
+} // namespace
+
+// Remove every path, keeping the memory for the next batch
+void wavefront_batch::clear() {
+  paths.clear();
+  active.clear();
+  missed.clear();
+  for (auto &bin : bins) {
+    bin.clear();
+  }
+}
+
+// Start a path at a camera ray
+void wavefront_batch::add(const ray &r, uint32_t pixel) {
+  active.push_back(uint32_t(paths.size()));
+  paths.push_back(wavefront_path{r, color(1, 1, 1), color(0, 0, 0), 0, pixel});
+}
+
+// Reorder the active paths by direction octant and origin cell
+void wavefront_batch::sort_active() {
+  if (active.size() < 2) {
+    return;
+  }
+
+  // Grid over the origins of this bounce only, scattered rays start on the
+  // surfaces hit, which may cover a small part of the scene
+  aabb bounds;
+  for (const uint32_t k : active) {
+    const point3 &origin = paths[k].current.origin();
+    bounds = aabb(bounds, aabb(origin, origin));
+  }
+
+  // Direction octant in the high bits, Morton code of the cell below
+  sort_keys.resize(active.size());
+  for (size_t n = 0; n < active.size(); n++) {
+    const ray &r = paths[active[n]].current;
+    uint32_t key = 0;
+    for (int axis = 0; axis < 3; axis++) {
+      const interval &extent = bounds.axis_interval(axis);
+      uint32_t cell = 0;
+      if (extent.size() > 0) {
+        const real offset = (r.origin()[axis] - extent.min) / extent.size();
+        cell = std::min(uint32_t(offset * origin_grid_cells),
+                        origin_grid_cells - 1);
+      }
+      key |= spread_bits(cell) << axis;
+      if (r.direction()[axis] < 0) {
+        key |= uint32_t(1) << (3 * origin_grid_bits + axis);
+      }
+    }
+    sort_keys[n] = key;
+  }
+
+  // Counting sort, which keeps the order of paths sharing a key
+  key_counts.assign(size_t(1) << (3 * origin_grid_bits + 3), 0);
+  for (const uint32_t key : sort_keys) {
+    key_counts[key]++;
+  }
+  uint32_t first = 0;
+  for (auto &count : key_counts) {
+    const uint32_t keys = count;
+    count = first;
+    first += keys;
+  }
+  sorted.resize(active.size());
+  for (size_t n = 0; n < active.size(); n++) {
+    sorted[key_counts[sort_keys[n]]++] = active[n];
+  }
+  active.swap(sorted);
+}
+
+// Intersect the current segment of every active path with the world
+void wavefront_batch::intersect(const hittable &world) {
+  if (hits.size() < paths.size()) {
+    hits.resize(paths.size());
+  }
+  missed.clear();
+  for (auto &bin : bins) {
+    bin.clear();
+  }
+
+  for (const uint32_t k : active) {
+    // Scattered rays start off the surface they leave, as in ray_color
+    if (world.hit(paths[k].current, interval(0, infinity), hits[k])) {
+      bins[size_t(hits[k].mat->kind())].push_back(k);
+    } else {
+      missed.push_back(k);
+    }
+  }
+  active.clear();
+}
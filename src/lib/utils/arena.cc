@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "utils/arena.h"
+
+arena::arena(size_t block_size) : block_size(block_size) {}
+
+// Destroy every object and free the blocks
+arena::~arena() { reset(); }
+
+// Place size bytes at alignment in the current block
+void *arena::place(size_t size, size_t alignment) {
+  const block &b = blocks[current];
+  const uintptr_t base = reinterpret_cast<uintptr_t>(b.data.get());
+  const uintptr_t start = (base + offset + alignment - 1) & ~(alignment - 1);
+  if (start + size > base + b.size) {
+    return nullptr;
+  }
+  offset = start + size - base;
+  used_bytes += size;
+  return reinterpret_cast<void *>(start);
+}
+
+// Uninitialized memory of size bytes, aligned to alignment
+void *arena::allocate(size_t size, size_t alignment) {
+  // The current block, then the ones kept by reset
+  for (; current < blocks.size(); current++, offset = 0) {
+    if (void *memory = place(size, alignment)) {
+      return memory;
+    }
+  }
+
+  // A new block, large enough for this allocation whatever its alignment
+  const size_t new_size = std::max(block_size, size + alignment);
+  blocks.push_back(block{std::unique_ptr<std::byte[]>(new std::byte[new_size]),
+                         new_size});
+  current = blocks.size() - 1;
+  offset = 0;
+  return place(size, alignment);
+}
+
+// Destroy every object in reverse order of creation, keeping the blocks
+void arena::reset() {
+  for (auto it = finalizers.rbegin(); it != finalizers.rend(); ++it) {
+    it->destroy(it->object);
+  }
+  finalizers.clear();
+  current = 0;
+  offset = 0;
+  used_bytes = 0;
+}
+
+size_t arena::bytes_used() const { return used_bytes; }
+
+size_t arena::block_count() const { return blocks.size(); }
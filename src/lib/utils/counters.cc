@@ -0,0 +1,38 @@
+#include <cstddef>
+#include <ostream>
+
+#include "utils/counters.h"
+
+// Add the counts of other
+void render_counters::merge(const render_counters &other) {
+  object_tests += other.object_tests;
+  bvh_nodes_visited += other.bvh_nodes_visited;
+  for (size_t kind = 0; kind < scatters.size(); kind++) {
+    scatters[kind] += other.scatters[kind];
+  }
+  for (size_t bin = 0; bin < path_lengths.size(); bin++) {
+    path_lengths[bin] += other.path_lengths[bin];
+  }
+}
+
+// Print the counters, one per line
+std::ostream &operator<<(std::ostream &out, const render_counters &counters) {
+  out << "Ray-object tests: " << counters.object_tests << '\n'
+      << "BVH nodes visited: " << counters.bvh_nodes_visited << '\n'
+      << "Scatter calls: lambertian "
+      << counters.scatters[size_t(material_kind::lambertian)] << ", metal "
+      << counters.scatters[size_t(material_kind::metal)] << ", dielectric "
+      << counters.scatters[size_t(material_kind::dielectric)] << '\n'
+      << "Path lengths:\n";
+
+  // Skip the empty bins, the last bin also holds the longer paths
+  for (size_t bin = 0; bin < counters.path_lengths.size(); bin++) {
+    if (counters.path_lengths[bin] == 0) {
+      continue;
+    }
+    out << "  " << bin
+        << (bin + 1 == counters.path_lengths.size() ? "+" : "") << ": "
+        << counters.path_lengths[bin] << '\n';
+  }
+  return out;
+}
@@ -0,0 +1,29 @@
+#include <cstddef>
+
+#include "utils/framebuffer.h"
+
+// Constructor, all pixels start black
+framebuffer::framebuffer(int width, int height)
+    : image_width(width), image_height(height),
+      data(size_t(width) * height * 3, 0.0f) {}
+
+// Image size in pixels
+int framebuffer::width() const { return image_width; }
+int framebuffer::height() const { return image_height; }
+
+// Get the pixel in column i, row j
+color framebuffer::get(int i, int j) const {
+  const float *p = &data[(size_t(j) * image_width + i) * 3];
+  return color(p[0], p[1], p[2]);
+}
+
+// Set the pixel in column i, row j
+void framebuffer::set(int i, int j, const color &pixel) {
+  float *p = &data[(size_t(j) * image_width + i) * 3];
+  p[0] = float(pixel.x());
+  p[1] = float(pixel.y());
+  p[2] = float(pixel.z());
+}
+
+// Raw RGB components, width * height * 3 floats
+const float *framebuffer::pixels() const { return data.data(); }
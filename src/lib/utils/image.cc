@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "utils/color.h"
+#include "utils/image.h"
+
+// 8-bit gamma corrected RGB bytes of the whole image
+static std::vector<unsigned char> to_bytes(const framebuffer &image) {
+  const size_t component_count = size_t(image.width()) * image.height() * 3;
+  const float *pixels = image.pixels();
+
+  std::vector<unsigned char> bytes(component_count);
+  for (size_t k = 0; k < component_count; k++) {
+    bytes[k] = color_component_to_byte(pixels[k]);
+  }
+  return bytes;
+}
+
+// Binary PPM: text header followed by raw RGB bytes
+static void write_ppm(std::ostream &os, const framebuffer &image) {
+  const std::string header = "P6\n" + std::to_string(image.width()) + ' ' +
+                             std::to_string(image.height()) + "\n255\n";
+  const auto bytes = to_bytes(image);
+
+  os.write(header.data(), header.size());
+  os.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+// Append a 32-bit big-endian integer
+static void append_u32(std::vector<unsigned char> &out, uint32_t value) {
+  out.push_back((value >> 24) & 0xff);
+  out.push_back((value >> 16) & 0xff);
+  out.push_back((value >> 8) & 0xff);
+  out.push_back(value & 0xff);
+}
+
+// Write a PNG chunk: length, type, data and CRC of type and data
+static void write_png_chunk(std::ostream &os, const char type[4],
+                            const std::vector<unsigned char> &data) {
+  std::vector<unsigned char> chunk;
+  chunk.reserve(data.size() + 12);
+  append_u32(chunk, uint32_t(data.size()));
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+
+  // CRC covers type and data, not the length
+  const uLong crc = crc32(0L, chunk.data() + 4, uInt(data.size() + 4));
+  append_u32(chunk, uint32_t(crc));
+
+  os.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+}
+
+// PNG: 8-bit RGB, one zlib stream for all scanlines
+static void write_png(std::ostream &os, const framebuffer &image) {
+  static const unsigned char signature[8] = {0x89, 'P',  'N',  'G',
+                                             '\r', '\n', 0x1a, '\n'};
+  os.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+  // Header: size, bit depth 8, color type 2 (RGB), default compression,
+  // filter and no interlace
+  std::vector<unsigned char> header;
+  append_u32(header, uint32_t(image.width()));
+  append_u32(header, uint32_t(image.height()));
+  header.insert(header.end(), {8, 2, 0, 0, 0});
+  write_png_chunk(os, "IHDR", header);
+
+  // Every scanline starts with its filter type, 0 (none)
+  const auto bytes = to_bytes(image);
+  const size_t row_size = size_t(image.width()) * 3;
+  std::vector<unsigned char> scanlines;
+  scanlines.reserve((row_size + 1) * image.height());
+  for (int j = 0; j < image.height(); j++) {
+    scanlines.push_back(0);
+    scanlines.insert(scanlines.end(), bytes.begin() + j * row_size,
+                     bytes.begin() + (j + 1) * row_size);
+  }
+
+  // Compress the scanlines
+  uLongf compressed_size = compressBound(uLong(scanlines.size()));
+  std::vector<unsigned char> compressed(compressed_size);
+  if (compress2(compressed.data(), &compressed_size, scanlines.data(),
+                uLong(scanlines.size()), Z_DEFAULT_COMPRESSION) != Z_OK) {
+    throw std::runtime_error("Failed to compress PNG image data");
+  }
+  compressed.resize(compressed_size);
+  write_png_chunk(os, "IDAT", compressed);
+
+  write_png_chunk(os, "IEND", {});
+}
+
+// Portable float map: linear RGB floats, rows from bottom to top
+static void write_pfm(std::ostream &os, const framebuffer &image) {
+  // Negative scale marks little-endian floats
+  const std::string header = "PF\n" + std::to_string(image.width()) + ' ' +
+                             std::to_string(image.height()) + "\n-1.0\n";
+  os.write(header.data(), header.size());
+
+  const size_t row_size = size_t(image.width()) * 3;
+  for (int j = image.height() - 1; j >= 0; j--) {
+    os.write(reinterpret_cast<const char *>(image.pixels() + j * row_size),
+             row_size * sizeof(float));
+  }
+}
+
+// Parse a format name ("ppm", "png" or "pfm"), throws on unknown names
+image_format image_format_from_string(const std::string &name) {
+  if (name == "ppm") {
+    return image_format::ppm;
+  }
+  if (name == "png") {
+    return image_format::png;
+  }
+  if (name == "pfm") {
+    return image_format::pfm;
+  }
+  throw std::runtime_error("Unknown image format: '" + name +
+                           "'. Supported formats: ppm, png, pfm.");
+}
+
+// File extension of the format, without the dot
+std::string image_format_extension(image_format format) {
+  switch (format) {
+  case image_format::png:
+    return "png";
+  case image_format::pfm:
+    return "pfm";
+  case image_format::ppm:
+  default:
+    return "ppm";
+  }
+}
+
+// Encode the image to the stream, which must be opened in binary mode
+void write_image(std::ostream &os, const framebuffer &image,
+                 image_format format) {
+  switch (format) {
+  case image_format::png:
+    write_png(os, image);
+    break;
+  case image_format::pfm:
+    write_pfm(os, image);
+    break;
+  case image_format::ppm:
+  default:
+    write_ppm(os, image);
+    break;
+  }
+}
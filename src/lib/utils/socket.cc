@@ -0,0 +1,251 @@
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define SOCKET_POSIX 1
+#endif
+
+#include "utils/socket.h"
+
+socket_handle::socket_handle(socket_handle &&other) noexcept
+    : fd(std::exchange(other.fd, -1)) {}
+
+socket_handle &socket_handle::operator=(socket_handle &&other) noexcept {
+  if (this != &other) {
+    socket_handle closed(std::exchange(fd, std::exchange(other.fd, -1)));
+  }
+  return *this;
+}
+
+#ifdef SOCKET_POSIX
+
+namespace {
+
+// Prefix of Unix domain socket addresses
+constexpr const char unix_prefix[] = "unix:";
+
+bool is_unix_address(const std::string &address) {
+  return address.rfind(unix_prefix, 0) == 0;
+}
+
+// Unix domain socket address of "unix:/path"
+sockaddr_un unix_address(const std::string &address) {
+  const std::string path = address.substr(sizeof(unix_prefix) - 1);
+  sockaddr_un result{};
+  result.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(result.sun_path)) {
+    throw std::runtime_error("Invalid Unix socket path: " + address);
+  }
+  std::memcpy(result.sun_path, path.c_str(), path.size() + 1);
+  return result;
+}
+
+// TCP addresses of "host:port", the host may be empty when listening
+addrinfo *tcp_addresses(const std::string &address, bool listening) {
+  const size_t colon = address.rfind(':');
+  const std::string host =
+      colon == std::string::npos ? "" : address.substr(0, colon);
+  const std::string port =
+      colon == std::string::npos ? address : address.substr(colon + 1);
+  if (port.empty() || (host.empty() && !listening)) {
+    throw std::runtime_error("Invalid address, expected host:port: " +
+                             address);
+  }
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = listening ? AI_PASSIVE : 0;
+  addrinfo *addresses = nullptr;
+  const int error = getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                                port.c_str(), &hints, &addresses);
+  if (error != 0) {
+    throw std::runtime_error("Cannot resolve " + address + ": " +
+                             gai_strerror(error));
+  }
+  return addresses;
+}
+
+// Send tiles as soon as they are written rather than batching small messages
+void disable_nagle(int fd) {
+  const int enable = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+} // namespace
+
+socket_handle::~socket_handle() {
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+// Stop sending and receiving
+void socket_handle::shutdown() const {
+  if (fd >= 0) {
+    ::shutdown(fd, SHUT_RDWR);
+  }
+}
+
+// Send exactly size bytes
+bool socket_handle::send_all(const void *data, size_t size) const {
+  const char *bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    // A closed peer must fail the send, not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+    const ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+#else
+    const ssize_t sent = send(fd, bytes, size, 0);
+#endif
+    if (sent <= 0) {
+      return false;
+    }
+    bytes += sent;
+    size -= size_t(sent);
+  }
+  return true;
+}
+
+// Receive exactly size bytes
+bool socket_handle::receive_all(void *data, size_t size) const {
+  char *bytes = static_cast<char *>(data);
+  while (size > 0) {
+    const ssize_t received = recv(fd, bytes, size, 0);
+    if (received <= 0) {
+      return false;
+    }
+    bytes += received;
+    size -= size_t(received);
+  }
+  return true;
+}
+
+// Listen for connections on address
+socket_handle listen_socket(const std::string &address) {
+  if (is_unix_address(address)) {
+    const sockaddr_un unix_addr = unix_address(address);
+    socket_handle listener(socket(AF_UNIX, SOCK_STREAM, 0));
+    // Remove the socket file left by an earlier run, but nothing else
+    struct stat existing;
+    if (lstat(unix_addr.sun_path, &existing) == 0) {
+      if (!S_ISSOCK(existing.st_mode)) {
+        throw std::runtime_error("Cannot listen on " + address +
+                                 ": Path exists and is not a socket");
+      }
+      unlink(unix_addr.sun_path);
+    }
+    if (!listener.valid() ||
+        bind(listener.get(), reinterpret_cast<const sockaddr *>(&unix_addr),
+             sizeof(unix_addr)) != 0 ||
+        listen(listener.get(), SOMAXCONN) != 0) {
+      throw std::runtime_error("Cannot listen on " + address + ": " +
+                               std::strerror(errno));
+    }
+    return listener;
+  }
+
+  addrinfo *const addresses = tcp_addresses(address, true);
+  for (const addrinfo *a = addresses; a != nullptr; a = a->ai_next) {
+    socket_handle listener(socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+    if (!listener.valid()) {
+      continue;
+    }
+    // Allow restarting the coordinator right away on the same port
+    const int enable = 1;
+    setsockopt(listener.get(), SOL_SOCKET, SO_REUSEADDR, &enable,
+               sizeof(enable));
+    if (bind(listener.get(), a->ai_addr, a->ai_addrlen) == 0 &&
+        listen(listener.get(), SOMAXCONN) == 0) {
+      freeaddrinfo(addresses);
+      return listener;
+    }
+  }
+  freeaddrinfo(addresses);
+  throw std::runtime_error("Cannot listen on " + address + ": " +
+                           std::strerror(errno));
+}
+
+// Accept a connection, waiting at most timeout_ms milliseconds
+socket_handle accept_socket(const socket_handle &listener, int timeout_ms) {
+  pollfd ready{};
+  ready.fd = listener.get();
+  ready.events = POLLIN;
+  if (poll(&ready, 1, timeout_ms) <= 0) {
+    return socket_handle();
+  }
+
+  socket_handle connection(accept(listener.get(), nullptr, nullptr));
+  if (connection.valid()) {
+    disable_nagle(connection.get());
+  }
+  return connection;
+}
+
+// Connect to address
+socket_handle connect_socket(const std::string &address) {
+  if (is_unix_address(address)) {
+    const sockaddr_un unix_addr = unix_address(address);
+    socket_handle connection(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (!connection.valid() ||
+        connect(connection.get(),
+                reinterpret_cast<const sockaddr *>(&unix_addr),
+                sizeof(unix_addr)) != 0) {
+      throw std::runtime_error("Cannot connect to " + address + ": " +
+                               std::strerror(errno));
+    }
+    return connection;
+  }
+
+  addrinfo *const addresses = tcp_addresses(address, false);
+  for (const addrinfo *a = addresses; a != nullptr; a = a->ai_next) {
+    socket_handle connection(
+        socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+    if (connection.valid() &&
+        connect(connection.get(), a->ai_addr, a->ai_addrlen) == 0) {
+      freeaddrinfo(addresses);
+      disable_nagle(connection.get());
+      return connection;
+    }
+  }
+  freeaddrinfo(addresses);
+  throw std::runtime_error("Cannot connect to " + address + ": " +
+                           std::strerror(errno));
+}
+
+#else
+
+// Without POSIX sockets every operation fails
+
+socket_handle::~socket_handle() = default;
+
+void socket_handle::shutdown() const {}
+
+bool socket_handle::send_all(const void *, size_t) const { return false; }
+
+bool socket_handle::receive_all(void *, size_t) const { return false; }
+
+socket_handle listen_socket(const std::string &) {
+  throw std::runtime_error("Sockets are not supported on this platform");
+}
+
+socket_handle accept_socket(const socket_handle &, int) {
+  return socket_handle();
+}
+
+socket_handle connect_socket(const std::string &) {
+  throw std::runtime_error("Sockets are not supported on this platform");
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "utils/thread_pool.h"
+
+// Start the threads
+thread_pool::thread_pool(int thread_count) {
+  threads.reserve(thread_count);
+  for (int t = 0; t < thread_count; t++) {
+    threads.emplace_back(&thread_pool::worker_loop, this);
+  }
+}
+
+// Stop and join the threads
+thread_pool::~thread_pool() {
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  task_ready.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+int thread_pool::size() const { return int(threads.size()); }
+
+// Run task on every thread at once and wait until all of them return
+void thread_pool::run_on_all(const std::function<void()> &task) {
+  std::unique_lock<std::mutex> lock(mutex);
+  this->task = &task;
+  running = int(threads.size());
+  generation++;
+  task_ready.notify_all();
+
+  task_finished.wait(lock, [this]() { return running == 0; });
+  this->task = nullptr;
+}
+
+// Loop of every thread
+void thread_pool::worker_loop() {
+  uint64_t seen_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    task_ready.wait(lock, [&]() {
+      return stopping || generation != seen_generation;
+    });
+    if (stopping) {
+      return;
+    }
+    seen_generation = generation;
+
+    // Run the task without holding the lock
+    const std::function<void()> &current = *task;
+    lock.unlock();
+    current();
+    lock.lock();
+
+    if (--running == 0) {
+      task_finished.notify_all();
+    }
+  }
+}
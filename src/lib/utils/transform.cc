@@ -0,0 +1,98 @@
+#include <cmath>
+
+#include "utils/aabb.h"
+#include "utils/interval.h"
+#include "utils/rtweekend.h"
+#include "utils/transform.h"
+#include "utils/vec3.h"
+
+// Identity
+affine_transform::affine_transform()
+    : m{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, offset(0, 0, 0) {}
+
+// Move by offset
+affine_transform affine_transform::translation(const vec3 &offset) {
+  affine_transform result;
+  result.offset = offset;
+  return result;
+}
+
+// Rotate by degrees about the x, then the y, then the z axis
+affine_transform affine_transform::rotation(const vec3 &degrees) {
+  affine_transform rotations[3];
+  for (int axis = 0; axis < 3; axis++) {
+    const real theta = degrees_to_radians(degrees[axis]);
+    const real cos_theta = std::cos(theta);
+    const real sin_theta = std::sin(theta);
+    // The two other axes, in right-handed order
+    const int a = (axis + 1) % 3;
+    const int b = (axis + 2) % 3;
+    rotations[axis].m[a][a] = cos_theta;
+    rotations[axis].m[a][b] = -sin_theta;
+    rotations[axis].m[b][a] = sin_theta;
+    rotations[axis].m[b][b] = cos_theta;
+  }
+  return rotations[2] * rotations[1] * rotations[0];
+}
+
+// Scale along each axis
+affine_transform affine_transform::scaling(const vec3 &factors) {
+  affine_transform result;
+  for (int axis = 0; axis < 3; axis++) {
+    result.m[axis][axis] = factors[axis];
+  }
+  return result;
+}
+
+// Transform applying other first, then this
+affine_transform
+affine_transform::operator*(const affine_transform &other) const {
+  affine_transform result;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      result.m[i][j] = m[i][0] * other.m[0][j] + m[i][1] * other.m[1][j] +
+                       m[i][2] * other.m[2][j];
+    }
+  }
+  result.offset = apply_point(other.offset);
+  return result;
+}
+
+// Inverse transform
+affine_transform affine_transform::inverse() const {
+  // Inverse of the linear part from its cofactors
+  affine_transform result;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      const int i1 = (j + 1) % 3, i2 = (j + 2) % 3;
+      const int j1 = (i + 1) % 3, j2 = (i + 2) % 3;
+      result.m[i][j] = m[i1][j1] * m[i2][j2] - m[i1][j2] * m[i2][j1];
+    }
+  }
+  const real determinant = m[0][0] * result.m[0][0] +
+                           m[0][1] * result.m[1][0] +
+                           m[0][2] * result.m[2][0];
+  for (auto &row : result.m) {
+    for (auto &value : row) {
+      value /= determinant;
+    }
+  }
+
+  // Undo the translation after the linear part
+  result.offset = -result.apply_vector(offset);
+  return result;
+}
+
+// Box enclosing the transformed box
+aabb affine_transform::apply_box(const aabb &box) const {
+  // Transform every corner
+  aabb result;
+  for (int corner = 0; corner < 8; corner++) {
+    const point3 p(corner & 1 ? box.x.max : box.x.min,
+                   corner & 2 ? box.y.max : box.y.min,
+                   corner & 4 ? box.z.max : box.z.min);
+    const point3 q = apply_point(p);
+    result = aabb(result, aabb(q, q));
+  }
+  return result;
+}
@@ -1,19 +1,22 @@
+#include <cstdio>
 #include <exception>
+#include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
-#include <memory>
+#include <sstream>
 #include <string>
 
 #include <argparse/argparse.hpp>
 #include <toml++/toml.hpp>
 
-#include "hittables/hittable.h"
-#include "hittables/hittable_list.h"
-#include "hittables/material.h"
-#include "hittables/sphere.h"
+#include "scene/animation.h"
 #include "scene/camera.h"
-#include "utils/color.h"
-#include "utils/vec3.h"
+#include "scene/distributed.h"
+#include "scene/scene.h"
+#include "scene/scene_cache.h"
+#include "utils/counters.h"
+#include "utils/image.h"
 
 int main(int argc, char const *argv[]) {
   // Init argparse
@@ -23,6 +26,27 @@ int main(int argc, char const *argv[]) {
       .help("Path to the working directory")
       .default_value(std::string("."))
       .append();
+  // Add argument "--format", overriding the format in config.toml
+  program.add_argument("--format")
+      .help("Output image format: ppm, png or pfm (HDR)");
+  // Add argument "--tile-heatmap", writing the time spent per tile as an image
+  program.add_argument("--tile-heatmap")
+      .help("Also write the render time of every tile as a heatmap image")
+      .default_value(false)
+      .implicit_value(true);
+  // Add argument "--no-scene-cache", always parsing the spheres of config.toml
+  program.add_argument("--no-scene-cache")
+      .help("Neither read nor write the binary scene cache config.scene")
+      .default_value(false)
+      .implicit_value(true);
+  // Add argument "--coordinator", rendering with workers connecting to it
+  program.add_argument("--coordinator")
+      .help("Hand out tiles to workers connecting to this address (host:port, "
+            ":port or unix:/path) instead of rendering locally");
+  // Add argument "--worker", rendering tiles for a coordinator
+  program.add_argument("--worker")
+      .help("Render tiles for the coordinator at this address (host:port or "
+            "unix:/path), taking the config from it");
   // Check if the user provided a workdir
   try {
     // Example: ./ray-tracing-demo-cpu --working-directory=/path/to/dir
@@ -33,206 +57,179 @@ int main(int argc, char const *argv[]) {
     return 1;
   }
 
+  // Workers take everything from the coordinator
+  if (program.is_used("--worker")) {
+    return run_worker(program.get<std::string>("--worker")) ? 0 : 1;
+  }
+
   // Get the workdir and print it
   const auto workdir = program.get<std::string>("--working-directory");
   std::clog << "Working directory: " << workdir << "\n\n";
 
-  // Load config.toml using toml++ library
+  // Load config.toml using toml++ library, and its scene from the binary
+  // scene cache next to it when the config is unchanged
+  // The coordinator only sends config.toml to the workers, so it reads the
+  // text and the settings but no scene
+  const bool coordinator = program.is_used("--coordinator");
   toml::table config;
-  std::clog << "Loading config.toml: " << workdir + "/config.toml" << "\n";
+  std::string config_text;
+  scene world;
+  const auto config_path = workdir + "/config.toml";
+  const auto cache_path =
+      program.get<bool>("--no-scene-cache") ? "" : workdir + "/config.scene";
+  std::clog << "Loading config.toml: " << config_path << "\n";
   try {
-    config = toml::parse_file(workdir + "/config.toml");
+    if (coordinator) {
+      std::ifstream config_file(config_path, std::ios::binary);
+      if (!config_file) {
+        std::cerr << "Error: Cannot open config file: " << config_path
+                  << "\n";
+        return 1;
+      }
+      std::ostringstream config_stream;
+      config_stream << config_file.rdbuf();
+      config_text = config_stream.str();
+      config = toml::parse(config_text);
+    } else if (!load_scene_cached(config_path, cache_path, config, world)) {
+      return 1;
+    }
   } catch (toml::parse_error &err) {
-    std::cerr << "Error loading config.toml: " << workdir + "/config.toml"
-              << "\n";
+    std::cerr << "Error loading config.toml: " << config_path << "\n";
     std::cerr << err << "\n";
     return 1;
   }
   std::clog << "Loaded config.toml successfully.\n";
 
-  // Objects (World)
-
-  // Create world
-  hittable_list world;
-
-  // Create a sphere object list
-  const auto config_spheres = *config["Sphere"].as_array();
-
-  // Create material alias (from string to material class)
-  auto config_to_material =
-      [](const toml::table conf_object) -> std::shared_ptr<material> {
-    // 检查材质配置是否完整
-    if (!conf_object.contains("material") ||
-        !conf_object["material"].is_string()) {
-      std::cerr << "Error: Each sphere must have a valid 'material' property "
-                   "of type string.\n";
-      return nullptr;
-    }
-
-    // 检查albedo是否存在且是数组
-    if (!conf_object.contains("albedo") || !conf_object["albedo"].is_array()) {
-      std::cerr << "Error: Each sphere must have a valid 'albedo' property as "
-                   "an array of three numbers.\n";
-      return nullptr;
-    }
-
-    // 尝试解析albedo并检查其有效性
-    const color albedo(*conf_object["albedo"].as_array());
-    if (std::isnan(albedo.x()) || std::isinf(albedo.x()) ||
-        std::isnan(albedo.y()) || std::isinf(albedo.y()) ||
-        std::isnan(albedo.z()) || std::isinf(albedo.z())) {
-      std::cerr << "Error: Albedo contains invalid values: " << albedo << "\n";
-      return nullptr;
-    }
-
-    // 检查albedo颜色值是否在合理范围内(0-1)
-    if (albedo.x() < 0 || albedo.x() > 1 || albedo.y() < 0 || albedo.y() > 1 ||
-        albedo.z() < 0 || albedo.z() > 1) {
-      std::cerr << "Warning: Albedo values should typically be in range [0,1]. "
-                   "Current values: "
-                << albedo << "\n";
-      // 这里只是警告，不返回nullptr
-    }
-
-    // Get the material type
-    const auto material_type = conf_object["material"].as_string()->get();
-
-    if (material_type == "lambertian") {
-      return std::make_shared<lambertian>(albedo);
-    }
-
-    if (material_type == "metal") {
-      // 检查fuzz参数
-      if (!conf_object.contains("fuzz")) {
-        return std::make_shared<metal>(albedo, 0.0);
-      }
-
-      // 检查fuzz参数是否为浮点数
-      const auto fuzz_node = conf_object["fuzz"].as_floating_point();
-      if (!fuzz_node) {
-        std::cerr << "Error: Metal material 'fuzz' parameter must be a "
-                     "floating-point number.\n";
-        return nullptr;
-      }
-
-      // 获取fuzz值
-      const double fuzz = fuzz_node->get();
-
-      if (std::isnan(fuzz) || std::isinf(fuzz) || fuzz < 0) {
-        std::cerr << "Error: Metal material 'fuzz' parameter must be a "
-                     "non-negative number.\n";
-        return nullptr;
-      }
-
-      // fuzz值过大会导致渲染问题，通常应限制在0-1范围内
-      if (fuzz > 1) {
-        std::cerr << "Warning: Metal material 'fuzz' parameter should "
-                     "typically be in range [0,1]. Current value: "
-                  << fuzz << "\n";
-      }
-      return std::make_shared<metal>(albedo, fuzz);
-    }
-
-    if (material_type == "dielectric") {
-      // 检查refractive_index参数
-      if (!conf_object.contains("refractive_index")) {
-        return std::make_shared<dielectric>(1.0);
-      }
+  // Workers render the whole image of the coordinator, frame by frame
+  // animation is only rendered locally
+  if (coordinator && config.contains("Animation")) {
+    std::cerr << "Error: --coordinator can not render an [Animation].\n";
+    return 1;
+  }
 
-      // 检查refractive_index参数是否为浮点数
-      const auto refractive_index_node =
-          conf_object["refractive_index"].as_floating_point();
-      if (!refractive_index_node) {
-        std::cerr << "Error: Dielectric material 'refractive_index' must be "
-                     "a floating-point number.\n";
-        return nullptr;
-      }
+  // Build a bounding volume hierarchy over the flat list, specialized for
+  // scenes of spheres only; the coordinator traces no rays
+  const hittable *world_bvh = coordinator ? nullptr : &build_bvh(world);
 
-      // 获取refractive_index值
-      const double refractive_index = refractive_index_node->get();
+  // Output format, --format takes precedence over [Image] format
+  std::string format_name = "ppm";
+  if (const auto format_node = config["Image"]["format"].as_string()) {
+    format_name = format_node->get();
+  }
+  if (program.is_used("--format")) {
+    format_name = program.get<std::string>("--format");
+  }
+  image_format format;
+  try {
+    format = image_format_from_string(format_name);
+  } catch (const std::exception &err) {
+    std::cerr << "Error: " << err.what() << "\n";
+    return 1;
+  }
 
-      if (std::isnan(refractive_index) || std::isinf(refractive_index) ||
-          refractive_index <= 0) {
-        std::cerr << "Error: Dielectric material 'refractive_index' must be "
-                     "a positive number.\n";
-        return nullptr;
-      }
-      return std::make_shared<dielectric>(refractive_index);
+  // Open output file and write the image
+  const auto output_path =
+      workdir + "/output/output." + image_format_extension(format);
+  const auto save_image = [&](const framebuffer &image,
+                              const std::string &output_path) -> bool {
+    std::ofstream output_file(output_path, std::ios::binary);
+    if (!output_file) {
+      std::cerr << "Error: Cannot open output file: " << output_path << "\n";
+      return false;
     }
-
-    // Invalid type
-    std::cerr << "Error: Unknown material type: '" << material_type
-              << "'. Supported types: lambertian, metal, dielectric.\n";
-    return nullptr;
+    write_image(output_file, image, format);
+    return true;
   };
 
-  // For each spheres in the list
-  for (const auto &s : config_spheres) {
-    // Convert s to table
-    const auto s_table_node = s.as_table();
+  camera cam(config);
+  cam.set_lights(&world.lights);
 
-    // Check if the node is valid
-    if (!s_table_node) {
-      std::cerr << "Error: Sphere configuration is not a valid table.\n";
+  // Animation: render every frame of the camera path with the same scene and
+  // threads, writing frame N while frame N + 1 is traced
+  if (config.contains("Animation")) {
+    camera_path path;
+    if (!load_camera_path(config, path)) {
       return 1;
     }
 
-    // Convert to table
-    const auto s_table = *s_table_node;
+    std::future<bool> previous_frame_saved;
+    for (int frame = 0; frame < path.frames; frame++) {
+      const camera_keyframe key = path.at(frame);
+      framebuffer image(0, 0);
+      try {
+        cam.set_view(key.look_from, key.look_at);
+        image = cam.render_multithread(*world_bvh);
+      } catch (const std::exception &err) {
+        std::cerr << "Error: " << err.what() << "\n";
+        return 1;
+      }
 
-    // Create the material
-    const auto mat = config_to_material(s_table);
-    // Check if the material is valid
-    if (mat == nullptr) {
-      std::cerr << "Invalid material type: "
-                << s_table["material"].as_string()->get() << "\n";
-      return 1;
+      // Only one frame is written at a time
+      if (previous_frame_saved.valid() && !previous_frame_saved.get()) {
+        return 1;
+      }
+      char frame_name[32];
+      std::snprintf(frame_name, sizeof(frame_name), "frame_%04d.", frame);
+      const auto frame_path = workdir + "/output/" + frame_name +
+                              image_format_extension(format);
+      previous_frame_saved =
+          std::async(std::launch::async,
+                     [&save_image, frame_path, image = std::move(image)]() {
+                       return save_image(image, frame_path);
+                     });
+      std::clog << "Frame " << frame + 1 << " / " << path.frames << ": "
+                << frame_path << '\n';
     }
+    return previous_frame_saved.get() ? 0 : 1;
+  }
 
-    // Get the center and radius of the sphere
-    const auto center_node = s_table["center"].as_array();
-    if (!center_node || center_node->size() != 3) {
-      std::cerr << "Error: Sphere center must be an array of three numbers.\n";
-      return 1;
+  // Render
+  render_stats stats;
+  const auto render = [&]() -> framebuffer {
+    // Workers render the tiles, the coordinator only sends them config.toml
+    // Workers resolve relative OBJ paths against the absolute workdir
+    if (coordinator) {
+      return render_coordinator(
+          program.get<std::string>("--coordinator"), config_text,
+          std::filesystem::absolute(workdir).lexically_normal().string(), cam,
+          &stats);
     }
-    // Convert to point3
-    const auto center = point3(*center_node);
-
-    // Get radius node
-    const auto radius_node = s_table["radius"].as_floating_point();
-    if (!radius_node) {
-      std::cerr << "Error: Sphere radius must be a floating-point number.\n";
-      return 1;
+    // Progressive rendering writes the intermediate image after every pass
+    if (cam.is_progressive()) {
+      return cam.render_progressive(
+          *world_bvh,
+          [&](const framebuffer &image, int) { save_image(image, output_path); },
+          &stats);
     }
+    // return cam.render(world_bvh);
+    return cam.render_multithread(*world_bvh, &stats);
+  };
 
-    const auto radius = radius_node->get();
+  framebuffer image(0, 0);
+  try {
+    image = render();
+  } catch (const std::exception &err) {
+    std::cerr << "Error: " << err.what() << "\n";
+    return 1;
+  }
+  if (!save_image(image, output_path)) {
+    return 1;
+  }
 
-    // 添加有效性检查
-    // 检查中心点坐标是否合法（不是NaN或无穷大）
-    if (std::isnan(center.x()) || std::isinf(center.x()) ||
-        std::isnan(center.y()) || std::isinf(center.y()) ||
-        std::isnan(center.z()) || std::isinf(center.z())) {
-      std::cerr << "Invalid sphere center coordinates. Center: " << center
-                << "\n";
-      return 1;
-    }
+  // Workers count their own rays
+  if (counters_enabled && !coordinator) {
+    std::clog << "Rays traced: " << stats.rays << '\n' << stats.counters;
+  }
 
-    // 检查半径是否为正数且不是NaN或无穷大
-    if (radius <= 0 || std::isnan(radius) || std::isinf(radius)) {
-      std::cerr << "Invalid sphere radius: " << radius
-                << ". Radius must be a positive number.\n";
+  // Heatmap next to the image, showing which regions were expensive
+  if (program.get<bool>("--tile-heatmap")) {
+    const auto heatmap_path =
+        workdir + "/output/tile_heatmap." + image_format_extension(format);
+    if (!save_image(cam.tile_heatmap(stats), heatmap_path)) {
       return 1;
     }
-
-    // Add sphere to the world
-    world.add(std::make_shared<sphere>(center, radius, mat));
+    std::clog << "Tile heatmap: " << heatmap_path << '\n';
   }
-  // Open output file
-  std::ofstream output_file(workdir + "/output/output.ppm");
-  // Then render
-  camera cam(config);
-  // cam.render(world, output_file);
-  cam.render_multithread(world, output_file);
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include <string>
+
+#include <toml++/toml.hpp>
+
+#include "scene/animation.h"
+#include "test.h"
+#include "utils/vec3.h"
+
+TEST(keyframes_take_integer_arrays) {
+  camera_path path;
+  CHECK(load_camera_path(toml::parse(R"(
+[Animation]
+frames = 11
+
+[[Keyframe]]
+frame = 10
+look_from = [10, 0, 0]
+look_at = [0, 0, 0]
+
+[[Keyframe]]
+frame = 0
+look_from = [0.0, 2.0, 5.0]
+look_at = [0, 0, 0]
+)"),
+                         path));
+  CHECK(path.frames == 11);
+  CHECK(path.keyframes.size() == 2);
+  CHECK(path.keyframes[0].frame == 0);
+
+  // Halfway between the sorted keyframes
+  const camera_keyframe middle = path.at(5);
+  CHECK(middle.look_from.x() == 5 && middle.look_from.y() == 1 &&
+        middle.look_from.z() == 2.5);
+  CHECK(middle.look_at.x() == 0 && middle.look_at.y() == 0 &&
+        middle.look_at.z() == 0);
+}
+
+TEST(keyframes_reject_invalid_vectors) {
+  const auto loads = [](const char *keyframe) {
+    camera_path path;
+    return load_camera_path(
+        toml::parse(std::string("[Animation]\nframes = 2\n") + keyframe),
+        path);
+  };
+  CHECK(loads("[[Keyframe]]\nframe = 0\nlook_from = [0, 0, 1]\n"
+              "look_at = [0, 0, 0]\n"));
+  CHECK(!loads("[[Keyframe]]\nframe = 0\nlook_from = [0, \"a\", 1]\n"
+               "look_at = [0, 0, 0]\n"));
+  CHECK(!loads("[[Keyframe]]\nframe = 0\nlook_from = [0, 0, 1]\n"
+               "look_at = [0, 0]\n"));
+  CHECK(!loads("[[Keyframe]]\nframe = 0\nlook_from = [0, 0, 1]\n"));
+}
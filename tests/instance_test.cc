@@ -0,0 +1,134 @@
+#include <cmath>
+#include <string>
+
+#include <toml++/toml.hpp>
+
+#include "hittables/hittable.h"
+#include "hittables/instance.h"
+#include "hittables/material.h"
+#include "hittables/sphere.h"
+#include "scene/scene.h"
+#include "test.h"
+#include "utils/color.h"
+#include "utils/interval.h"
+#include "utils/ray.h"
+#include "utils/rtweekend.h"
+#include "utils/transform.h"
+#include "utils/vec3.h"
+
+namespace {
+
+// Tolerance of the float builds
+constexpr double tolerance = 1e-4;
+
+bool near(double a, double b) { return std::fabs(a - b) < tolerance; }
+
+bool near(const vec3 &a, const vec3 &b) {
+  return near(a.x(), b.x()) && near(a.y(), b.y()) && near(a.z(), b.z());
+}
+
+} // namespace
+
+TEST(instance_moves_and_scales_hits) {
+  const material mat = lambertian(color(0.5, 0.5, 0.5));
+  const sphere unit_sphere(point3(0, 0, 0), 1, &mat);
+  // Ellipsoid with radii 2, 1, 1 around (5, 0, 0)
+  const instance ellipsoid(&unit_sphere,
+                           affine_transform::translation(vec3(5, 0, 0)) *
+                               affine_transform::scaling(vec3(2, 1, 1)));
+
+  // Along the long axis
+  hit_record record;
+  CHECK(ellipsoid.hit(ray(point3(0, 0, 0), vec3(1, 0, 0)),
+                      interval(0.001, infinity), record));
+  CHECK(near(record.t, 3));
+  CHECK(near(record.point, point3(3, 0, 0)));
+  CHECK(near(record.normal, vec3(-1, 0, 0)));
+  CHECK(record.front_face);
+  CHECK(record.mat == &mat);
+
+  // Off the center, where the scaling moves the hit but not the depth
+  CHECK(ellipsoid.hit(ray(point3(6.5, 0, 10), vec3(0, 0, -1)),
+                      interval(0.001, infinity), record));
+  const double z = std::sqrt(1 - 0.75 * 0.75);
+  CHECK(near(record.t, 10 - z));
+  CHECK(near(record.point, point3(6.5, 0, z)));
+
+  // Beyond the short axis, hit by the untransformed sphere
+  CHECK(!ellipsoid.hit(ray(point3(0.5, 0, 10), vec3(0, 0, -1)),
+                       interval(0.001, infinity), record));
+  CHECK(!ellipsoid.occluded(ray(point3(5, 1.5, 10), vec3(0, 0, -1)),
+                            interval(0.001, infinity)));
+  CHECK(ellipsoid.occluded(ray(point3(5, 0.5, 10), vec3(0, 0, -1)),
+                           interval(0.001, infinity)));
+
+  const aabb box = ellipsoid.bounding_box();
+  CHECK(box.x.min <= 3 && box.x.max >= 7 && box.x.min > 2.9 &&
+        box.x.max < 7.1);
+}
+
+TEST(instance_normals_stay_perpendicular) {
+  const material mat = lambertian(color(0.5, 0.5, 0.5));
+  const sphere unit_sphere(point3(0, 0, 0), 1, &mat);
+  const affine_transform object_to_world =
+      affine_transform::translation(vec3(1, 2, 3)) *
+      affine_transform::rotation(vec3(30, 45, 60)) *
+      affine_transform::scaling(vec3(3, 1, 0.5));
+  const instance ellipsoid(&unit_sphere, object_to_world);
+
+  // Aim at the image of a point of the sphere, from outside along the line
+  // through the center, so no other part of the ellipsoid is in the way
+  const double c = std::cos(0.7), s = std::sin(0.7);
+  const point3 center = object_to_world.apply_point(point3(0, 0, 0));
+  const point3 target = object_to_world.apply_point(point3(c, s, 0));
+  const point3 origin = center + 6 * (target - center);
+  hit_record record;
+  CHECK(ellipsoid.hit(ray(origin, target - origin),
+                      interval(0.001, infinity), record));
+  CHECK(near(record.point, target));
+
+  // The normal is a unit vector perpendicular to the transformed tangents,
+  // facing the ray
+  const vec3 tangent_u = object_to_world.apply_vector(vec3(-s, c, 0));
+  const vec3 tangent_v = object_to_world.apply_vector(vec3(0, 0, 1));
+  CHECK(near(record.normal.length(), 1));
+  CHECK(near(dot(record.normal, unit_vector(tangent_u)), 0));
+  CHECK(near(dot(record.normal, unit_vector(tangent_v)), 0));
+  CHECK(dot(record.normal, target - origin) < 0);
+}
+
+TEST(instance_tables_take_integer_arrays) {
+  const std::string object = R"(
+[[Object]]
+name = "ball"
+[[Object.Sphere]]
+center = [0, 0, 0]
+radius = 1.0
+material = "lambertian"
+albedo = [0.5, 0.5, 0.5]
+)";
+
+  // Rotating about the long axis keeps the ellipsoid from x = 3 to x = 7
+  scene world;
+  CHECK(load_scene(toml::parse(object + R"(
+[[Instance]]
+object = "ball"
+translate = [5, 0, 0]
+rotate = [90, 0, 0]
+scale = [2, 1, 1]
+)"),
+                   world));
+  hit_record record;
+  CHECK(build_bvh(world).hit(ray(point3(0, 0, 0), vec3(1, 0, 0)),
+                             interval(0.001, infinity), record));
+  CHECK(near(record.t, 3));
+
+  // Anything but numbers is an error, not a crash
+  scene invalid;
+  CHECK(!load_scene(toml::parse(object + R"(
+[[Instance]]
+object = "ball"
+translate = [5, true, 0]
+)"),
+                    invalid));
+}
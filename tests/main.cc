@@ -0,0 +1,57 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+// Failures of the running test
+int failures = 0;
+
+// Directory of the files written by the tests, removed at the end
+std::filesystem::path test_directory() {
+  static const std::filesystem::path directory = [] {
+    auto path = std::filesystem::temp_directory_path() / "ray-tracing-tests";
+    std::filesystem::create_directories(path);
+    return path;
+  }();
+  return directory;
+}
+
+} // namespace
+
+std::vector<test_case> &test_cases() {
+  static std::vector<test_case> cases;
+  return cases;
+}
+
+// Report that condition failed at file and line
+void test_failure(const char *file, int line, const char *condition) {
+  std::cerr << file << ":" << line << ": CHECK(" << condition << ") failed\n";
+  failures++;
+}
+
+// Path of a file named name in a directory removed after the tests
+std::string test_path(const std::string &name) {
+  return (test_directory() / name).string();
+}
+
+int main() {
+  int failed = 0;
+  for (const auto &test : test_cases()) {
+    failures = 0;
+    test.run();
+    std::clog << (failures == 0 ? "PASS " : "FAIL ") << test.name << "\n";
+    failed += failures == 0 ? 0 : 1;
+  }
+
+  std::error_code error;
+  std::filesystem::remove_all(test_directory(), error);
+
+  std::clog << test_cases().size() - failed << "/" << test_cases().size()
+            << " tests passed\n";
+  return failed == 0 ? 0 : 1;
+}
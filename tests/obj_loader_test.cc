@@ -0,0 +1,86 @@
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "hittables/triangle_mesh.h"
+#include "scene/obj_loader.h"
+#include "test.h"
+#include "utils/vec3.h"
+
+namespace {
+
+// Write the OBJ text to a file and load it
+bool load_obj_text(const std::string &text, std::vector<point3> &vertices,
+                   std::vector<triangle_mesh::triangle> &triangles) {
+  const std::string path = test_path("mesh.obj");
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+  }
+  vertices.clear();
+  triangles.clear();
+  return load_obj(path, vertices, triangles);
+}
+
+} // namespace
+
+TEST(obj_polygons_are_split_into_fans) {
+  std::vector<point3> vertices;
+  std::vector<triangle_mesh::triangle> triangles;
+  CHECK(load_obj_text("# Pentagon and a triangle\n"
+                      "v 0 0 0\n"
+                      "v 1 0 0\n"
+                      "v 1.5 1 0\n"
+                      "v 0.5 2 0\n"
+                      "v -0.5 1 0\n"
+                      "vt 0 0\n"
+                      "vn 0 0 1\n"
+                      "f 1/1/1 2/1/1 3/1/1 4/1/1 5/1/1\n"
+                      "g triangle\n"
+                      "f 1//1 3//1 5//1\n",
+                      vertices, triangles));
+  CHECK(vertices.size() == 5);
+  CHECK(vertices[2].x() == 1.5 && vertices[2].y() == 1);
+
+  // Fan around the first corner, then the triangle as is
+  const std::vector<triangle_mesh::triangle> expected = {
+      {0, 1, 2}, {0, 2, 3}, {0, 3, 4}, {0, 2, 4}};
+  CHECK(triangles == expected);
+}
+
+TEST(obj_negative_indices_count_back) {
+  std::vector<point3> vertices;
+  std::vector<triangle_mesh::triangle> triangles;
+  CHECK(load_obj_text("v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+                      "f -3 -2 -1\n",
+                      vertices, triangles));
+  const std::vector<triangle_mesh::triangle> expected = {{1, 2, 3}};
+  CHECK(triangles == expected);
+}
+
+TEST(obj_rejects_bad_indices) {
+  std::vector<point3> vertices;
+  std::vector<triangle_mesh::triangle> triangles;
+  const std::string vertex_lines = "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+  // Beyond the vertices read so far
+  CHECK(!load_obj_text(vertex_lines + "f 1 2 4\n", vertices, triangles));
+  // OBJ indices start at 1
+  CHECK(!load_obj_text(vertex_lines + "f 0 1 2\n", vertices, triangles));
+  CHECK(!load_obj_text(vertex_lines + "f -4 1 2\n", vertices, triangles));
+  // Vertices after the face do not count
+  CHECK(!load_obj_text("v 0 0 0\nv 1 0 0\nf 1 2 3\nv 0 1 0\n", vertices,
+                       triangles));
+  // Not a number, or too few corners
+  CHECK(!load_obj_text(vertex_lines + "f 1 x 3\n", vertices, triangles));
+  CHECK(!load_obj_text(vertex_lines + "f 1 2\n", vertices, triangles));
+}
+
+TEST(obj_rejects_bad_vertices) {
+  std::vector<point3> vertices;
+  std::vector<triangle_mesh::triangle> triangles;
+  CHECK(!load_obj_text("v 0 0\n", vertices, triangles));
+  CHECK(!load_obj_text("v 0 nan 0\n", vertices, triangles));
+  CHECK(!load_obj_text("v 0 0 inf\n", vertices, triangles));
+  CHECK(!load_obj_text("v 1e999 0 0\n", vertices, triangles));
+  CHECK(!load_obj(test_path("missing.obj"), vertices, triangles));
+}
@@ -0,0 +1,233 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <toml++/toml.hpp>
+
+#include "hittables/hittable.h"
+#include "hittables/material.h"
+#include "scene/scene.h"
+#include "scene/scene_cache.h"
+#include "test.h"
+#include "utils/interval.h"
+#include "utils/ray.h"
+#include "utils/rtweekend.h"
+#include "utils/vec3.h"
+
+namespace {
+
+// Spheres of every material kind, a moving one, and tables the cache does not
+// cover before and after them
+const char scene_config[] = R"(# Test scene
+[Camera]
+look_from = [0.0, 1.0, 6.0]
+
+[[Sphere]]
+center = [0.0, -100.5, -1.0]
+radius = 100.0
+material = "lambertian"
+albedo = [0.8, 0.8, 0.0]
+
+[[Sphere]]
+center = [
+  0.0, 0.0, -1.0,
+]
+radius = 0.5
+material = "metal"
+albedo = [0.8, 0.6, 0.2]
+fuzz = 0.3
+
+[[Sphere]]
+center = [-1.0, 0.0, -1.0]
+radius = 0.5
+material = "dielectric"
+albedo = [1.0, 1.0, 1.0]
+refractive_index = 1.5
+
+[[Sphere]]
+center = [1.0, 0.0, -1.0]
+center1 = [1.0, 0.5, -1.0]
+radius = 0.5
+material = "lambertian"
+albedo = [0.8, 0.8, 0.0]
+
+[[Sphere]]
+center = [0.0, 3.0, 0.0]
+radius = 1.0
+material = "light"
+emission = [4.0, 4.0, 4.0]
+
+[Ray]
+max_depth = 20
+)";
+
+// Write text to the file at path
+void write_file(const std::string &path, const std::string &text) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << text;
+}
+
+// Whether the two hierarchies give the same hits for a fan of rays
+bool same_hits(const hittable &a, const hittable &b) {
+  int hits = 0;
+  for (int y = 0; y < 16; y++) {
+    for (int x = 0; x < 16; x++) {
+      const ray r(point3(0, 1, 6), vec3(x / 8.0 - 1, y / 8.0 - 1, -1),
+                  (x + y) / 32.0);
+      hit_record record_a, record_b;
+      const bool hit_a = a.hit(r, interval(0.001, infinity), record_a);
+      const bool hit_b = b.hit(r, interval(0.001, infinity), record_b);
+      if (hit_a != hit_b) {
+        return false;
+      }
+      if (!hit_a) {
+        continue;
+      }
+      hits++;
+      if (record_a.t != record_b.t ||
+          record_a.normal.x() != record_b.normal.x() ||
+          record_a.normal.y() != record_b.normal.y() ||
+          record_a.normal.z() != record_b.normal.z() ||
+          record_a.mat->kind() != record_b.mat->kind()) {
+        return false;
+      }
+    }
+  }
+  return hits > 0;
+}
+
+} // namespace
+
+TEST(scene_cache_round_trip) {
+  const std::string config_path = test_path("round_trip.toml");
+  const std::string cache_path = test_path("round_trip.scene");
+  write_file(config_path, scene_config);
+  std::remove(cache_path.c_str());
+
+  // The first load parses the spheres and writes the cache
+  toml::table written_config;
+  scene written;
+  CHECK(load_scene_cached(config_path, cache_path, written_config, written));
+  scene direct;
+  CHECK(load_scene_cache(cache_path, scene_source_hash(scene_config), direct));
+
+  // The second load reads the spheres from the cache
+  toml::table cached_config;
+  scene cached;
+  CHECK(load_scene_cached(config_path, cache_path, cached_config, cached));
+
+  // Both match the scene loaded without a cache
+  const toml::table config = toml::parse(scene_config);
+  scene loaded;
+  CHECK(load_scene(config, loaded));
+
+  CHECK(cached.objects.objects.size() == loaded.objects.objects.size());
+  CHECK(written.objects.objects.size() == loaded.objects.objects.size());
+  CHECK(cached.lights.size() == loaded.lights.size());
+  CHECK(cached_config["Camera"].is_table());
+  CHECK(cached_config["Ray"]["max_depth"].value_or(0) == 20);
+  CHECK(!cached_config.contains("Sphere"));
+
+  const hittable &loaded_bvh = build_bvh(loaded);
+  CHECK(same_hits(build_bvh(cached), loaded_bvh));
+  CHECK(same_hits(build_bvh(written), loaded_bvh));
+}
+
+TEST(scene_cache_rejects_invalid_records) {
+  const std::string cache_path = test_path("invalid.scene");
+  const uint64_t hash = scene_source_hash("invalid");
+
+  scene_desc desc;
+  material_desc mat{};
+  mat.type = material_kind::metal;
+  mat.albedo[0] = mat.albedo[1] = mat.albedo[2] = 0.5;
+  mat.parameter = 0.1;
+  desc.materials.push_back(mat);
+  sphere_desc sph{};
+  sph.radius = 1;
+  desc.spheres.push_back(sph);
+
+  // Valid records are read back, but not for another config
+  CHECK(save_scene_cache(cache_path, hash, desc));
+  scene valid;
+  CHECK(load_scene_cache(cache_path, hash, valid));
+  CHECK(valid.objects.objects.size() == 1);
+  scene stale;
+  CHECK(!load_scene_cache(cache_path, hash + 1, stale));
+
+  // Each record the [[Sphere]] parsing would reject
+  const auto rejected = [&](const scene_desc &invalid) {
+    scene world;
+    return save_scene_cache(cache_path, hash, invalid) &&
+           !load_scene_cache(cache_path, hash, world) &&
+           world.objects.objects.empty();
+  };
+  scene_desc invalid = desc;
+  invalid.spheres[0].radius = std::nan("");
+  CHECK(rejected(invalid));
+  invalid = desc;
+  invalid.spheres[0].radius = -1;
+  CHECK(rejected(invalid));
+  invalid = desc;
+  invalid.spheres[0].motion[1] = infinity;
+  CHECK(rejected(invalid));
+  invalid = desc;
+  invalid.spheres[0].material = 1;
+  CHECK(rejected(invalid));
+  invalid = desc;
+  invalid.materials[0].type = material_kind::count;
+  CHECK(rejected(invalid));
+  invalid = desc;
+  invalid.materials[0].parameter = -0.5;
+  CHECK(rejected(invalid));
+  invalid = desc;
+  invalid.materials[0].albedo[2] = std::nan("");
+  CHECK(rejected(invalid));
+
+  // Record counts beyond the end of the file
+  CHECK(save_scene_cache(cache_path, hash, desc));
+  {
+    std::fstream file(cache_path, std::ios::binary | std::ios::in |
+                                      std::ios::out);
+    const uint64_t sphere_count = 2;
+    file.seekp(16);
+    file.write(reinterpret_cast<const char *>(&sphere_count),
+               sizeof(sphere_count));
+  }
+  scene truncated;
+  CHECK(!load_scene_cache(cache_path, hash, truncated));
+}
+
+TEST(strip_sphere_tables_keeps_other_tables) {
+  std::string stripped;
+  CHECK(strip_sphere_tables(scene_config, stripped));
+  const toml::table config = toml::parse(stripped);
+  CHECK(!config.contains("Sphere"));
+  CHECK(config["Camera"]["look_from"].is_array());
+  CHECK(config["Ray"]["max_depth"].value_or(0) == 20);
+
+  // Lines of a multi-line array are not table headers
+  CHECK(strip_sphere_tables("[[Sphere]]\nc = [\n  [1],\n]\n[Ray]\nx = 1\n",
+                            stripped));
+  CHECK(stripped == "[Ray]\nx = 1\n");
+  // Nor are brackets in strings and comments
+  CHECK(strip_sphere_tables("[[Mesh]] # [[Sphere]]\nfile = \"[a] # b\"\n",
+                            stripped));
+  CHECK(stripped == "[[Mesh]] # [[Sphere]]\nfile = \"[a] # b\"\n");
+}
+
+TEST(strip_sphere_tables_gives_up_on_unknown_forms) {
+  std::string stripped;
+  // Multi-line strings
+  CHECK(!strip_sphere_tables("[[Sphere]]\nname = \"\"\"\n[x]\"\"\"\n",
+                             stripped));
+  // Sphere tables other than [[Sphere]]
+  CHECK(!strip_sphere_tables("[Sphere]\nx = 1\n", stripped));
+  CHECK(!strip_sphere_tables("[[Sphere.a]]\nx = 1\n", stripped));
+  CHECK(!strip_sphere_tables("Sphere = [{radius = 1.0}]\n", stripped));
+  // Quoted keys
+  CHECK(!strip_sphere_tables("[\"Sphere\"]\nx = 1\n", stripped));
+  CHECK(!strip_sphere_tables("\"Sphere\" = 1\n", stripped));
+}
@@ -0,0 +1,82 @@
+#include <string>
+
+#include <toml++/toml.hpp>
+
+#include "hittables/hittable.h"
+#include "scene/scene.h"
+#include "test.h"
+#include "utils/interval.h"
+#include "utils/ray.h"
+#include "utils/rtweekend.h"
+#include "utils/vec3.h"
+
+namespace {
+
+// Load the config text into world
+bool load_scene_text(const std::string &text, scene &world) {
+  return load_scene(toml::parse(text), world);
+}
+
+} // namespace
+
+TEST(moving_sphere_takes_integer_center1) {
+  scene world;
+  CHECK(load_scene_text(R"(
+[[Sphere]]
+center = [0, 0, 0]
+center1 = [0, 4, 0]
+radius = 1.0
+material = "lambertian"
+albedo = [0.5, 0.5, 0.5]
+)",
+                        world));
+
+  // At time 1 the sphere is around (0, 4, 0)
+  const hittable &world_bvh = build_bvh(world);
+  hit_record record;
+  CHECK(world_bvh.hit(ray(point3(0, 4, 10), vec3(0, 0, -1), 1),
+                      interval(0.001, infinity), record));
+  CHECK(!world_bvh.hit(ray(point3(0, 4, 10), vec3(0, 0, -1), 0),
+                       interval(0.001, infinity), record));
+
+  scene invalid;
+  CHECK(!load_scene_text(R"(
+[[Sphere]]
+center = [0, 0, 0]
+center1 = [0, "up", 0]
+radius = 1.0
+material = "lambertian"
+albedo = [0.5, 0.5, 0.5]
+)",
+                         invalid));
+}
+
+TEST(sphere_center_rejects_non_numbers) {
+  scene world;
+  CHECK(!load_scene_text(R"(
+[[Sphere]]
+center = [0, false, 0]
+radius = 1.0
+material = "lambertian"
+albedo = [0.5, 0.5, 0.5]
+)",
+                         world));
+}
+
+TEST(light_takes_integer_emission) {
+  const auto light = [](const char *emission) {
+    scene world;
+    const bool loaded = load_scene_text(std::string(R"(
+[[Sphere]]
+center = [0.0, 3.0, 0.0]
+radius = 1.0
+material = "light"
+emission = )") + emission + "\n",
+                                        world);
+    return loaded && world.lights.size() == 1;
+  };
+  CHECK(light("[4, 4, 4]"));
+  CHECK(light("[4.0, 2, 0]"));
+  CHECK(!light("[4, \"4\", 4]"));
+  CHECK(!light("[4, -1, 4]"));
+}
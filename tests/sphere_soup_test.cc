@@ -0,0 +1,170 @@
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "hittables/hittable.h"
+#include "hittables/material.h"
+#include "hittables/sphere.h"
+#include "hittables/sphere_soup.h"
+#include "test.h"
+#include "utils/color.h"
+#include "utils/interval.h"
+#include "utils/ray.h"
+#include "utils/rtweekend.h"
+#include "utils/vec3.h"
+
+namespace {
+
+// Relative tolerance, the scalar spheres use float in float builds while the
+// kernels always use double
+constexpr double tolerance = 1e4 * std::numeric_limits<real>::epsilon();
+
+bool near(double a, double b) {
+  return std::fabs(a - b) < tolerance * std::fmax(1.0, std::fabs(b));
+}
+
+// Random point in the cube from -size to size
+point3 random_point(double size) {
+  return point3(random_double(-size, size), random_double(-size, size),
+                random_double(-size, size));
+}
+
+// Random ray from outside or from inside the spheres
+ray random_ray(int n) {
+  const point3 origin = random_point(n % 4 == 0 ? 2 : 8);
+  return ray(origin, random_point(1) - 0.3 * origin);
+}
+
+// Whether record is the same hit as expected
+bool same_hit(const hit_record &record, const hit_record &expected) {
+  return near(record.t, expected.t) && record.mat == expected.mat &&
+         record.front_face == expected.front_face &&
+         near(record.normal.x(), expected.normal.x()) &&
+         near(record.normal.y(), expected.normal.y()) &&
+         near(record.normal.z(), expected.normal.z());
+}
+
+// Nearest hit of the spheres one by one
+bool nearest_hit(const std::vector<sphere> &spheres, const ray &r,
+                 interval ray_t, hit_record &record) {
+  bool hit = false;
+  for (const auto &s : spheres) {
+    if (s.hit(r, ray_t, record)) {
+      hit = true;
+      ray_t.max = record.t;
+    }
+  }
+  return hit;
+}
+
+// Compare soups of every size with the selected kernels against the spheres
+// one by one, returns the number of hits
+int check_soups_match_spheres() {
+  seed_random(5);
+  std::vector<material> materials;
+  for (size_t k = 0; k < sphere_soup::max_leaf_size; k++) {
+    materials.push_back(lambertian(color(0.1 * k, 0.5, 0.5)));
+  }
+
+  int hits = 0;
+  // Every soup size, so the kernels see partly filled lanes too
+  for (size_t count = 1; count <= sphere_soup::max_leaf_size; count++) {
+    std::vector<sphere> spheres;
+    sphere_soup soup;
+    for (size_t k = 0; k < count; k++) {
+      spheres.emplace_back(random_point(3), random_double(0.2, 1.5),
+                           &materials[k]);
+      soup.add(spheres.back());
+    }
+    CHECK(soup.size() == count);
+
+    aabb box;
+    for (const auto &s : spheres) {
+      box = aabb(box, s.bounding_box());
+    }
+    const aabb soup_box = soup.bounding_box();
+    CHECK(near(soup_box.x.min, box.x.min) && near(soup_box.x.max, box.x.max));
+    CHECK(near(soup_box.z.min, box.z.min) && near(soup_box.z.max, box.z.max));
+
+    for (int n = 0; n < 2000; n++) {
+      // Some of the rays are short
+      const ray r = random_ray(n);
+      const interval ray_t(0.001, n % 3 == 0 ? 4.0 : double(infinity));
+
+      hit_record expected;
+      const bool expected_hit = nearest_hit(spheres, r, ray_t, expected);
+
+      hit_record record;
+      const bool soup_hit = soup.hit(r, ray_t, record);
+      CHECK(soup_hit == expected_hit);
+      CHECK(soup.occluded(r, ray_t) == expected_hit);
+      if (soup_hit && expected_hit) {
+        hits++;
+        CHECK(same_hit(record, expected));
+      }
+    }
+
+    // Packets of every size up to more than one kernel call
+    for (size_t packet = 1; packet <= 2 * sphere_soup::max_packet_size + 1;
+         packet++) {
+      std::vector<ray> rays;
+      for (size_t k = 0; k < packet; k++) {
+        rays.push_back(random_ray(int(k)));
+      }
+      const interval ray_t(0.001, infinity);
+      std::vector<hit_record> records(packet);
+      bool packet_hits[2 * sphere_soup::max_packet_size + 1];
+      soup.hit_packet(rays.data(), packet, ray_t, records.data(),
+                      packet_hits);
+      for (size_t k = 0; k < packet; k++) {
+        hit_record expected;
+        const bool expected_hit = nearest_hit(spheres, rays[k], ray_t, expected);
+        CHECK(packet_hits[k] == expected_hit);
+        if (packet_hits[k] && expected_hit) {
+          CHECK(same_hit(records[k], expected));
+        }
+      }
+    }
+  }
+  return hits;
+}
+
+} // namespace
+
+TEST(sphere_soup_uses_simd_when_available) {
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    CHECK(std::strcmp(sphere_soup::simd_name(), "scalar") != 0);
+  }
+#endif
+
+  const std::string selected = sphere_soup::simd_name();
+  CHECK(!sphere_soup::select_simd("sse9"));
+  CHECK(sphere_soup::simd_name() == selected);
+  CHECK(sphere_soup::select_simd("scalar"));
+  CHECK(std::strcmp(sphere_soup::simd_name(), "scalar") == 0);
+  CHECK(sphere_soup::select_simd(selected.c_str()));
+}
+
+TEST(sphere_soup_matches_scalar_spheres) {
+  const std::string selected = sphere_soup::simd_name();
+
+  // Every instruction set the CPU supports, not only the widest
+  int kernels_checked = 0;
+  for (const char *name : {"avx512", "avx2", "scalar"}) {
+    if (!sphere_soup::select_simd(name)) {
+      continue;
+    }
+    CHECK(std::strcmp(sphere_soup::simd_name(), name) == 0);
+    CHECK(check_soups_match_spheres() > 1000);
+    kernels_checked++;
+  }
+  CHECK(kernels_checked > 0);
+
+  CHECK(sphere_soup::select_simd(selected.c_str()));
+}
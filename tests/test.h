@@ -0,0 +1,35 @@
+#pragma once
+// Minimal test harness: TEST(name) defines a test run by tests/main.cc, and
+// CHECK(condition) reports a failure of the running test without stopping it
+
+#include <string>
+#include <vector>
+
+struct test_case {
+  const char *name;
+  void (*run)();
+};
+
+// Every test defined by TEST, in the order of their registration
+std::vector<test_case> &test_cases();
+
+// Report that condition failed at file and line
+void test_failure(const char *file, int line, const char *condition);
+
+// Path of a file named name in a directory removed after the tests
+std::string test_path(const std::string &name);
+
+// Registers a test before main runs
+struct test_registrar {
+  test_registrar(const char *name, void (*run)()) {
+    test_cases().push_back({name, run});
+  }
+};
+
+#define TEST(name)                                                             \
+  static void name();                                                          \
+  static const test_registrar name##_registrar(#name, name);                   \
+  static void name()
+
+#define CHECK(condition)                                                       \
+  ((condition) ? (void)0 : test_failure(__FILE__, __LINE__, #condition))
@@ -4,11 +4,75 @@ add_rules("plugin.compile_commands.autoupdate", {lsp = "clangd"})
 set_languages("c++17")
 add_requires("toml++")
 add_requires("argparse")
+add_requires("zlib")
 
-target("ray-tracing-demo-cpu")
-  set_kind("binary")
-  add_includedirs("include")
-  add_files("src/lib/*/*.cc")
-  add_files("src/main.cc")
-  add_packages("toml++")
-  add_packages("argparse")
+-- Optimize for the building machine (-march=native) and enable link time
+-- optimization, e.g. `xmake f --native=y`
+option("native")
+  set_default(false)
+  set_showmenu(true)
+  set_description("Build with -march=native and link time optimization")
+option_end()
+
+-- Count ray-object tests, BVH nodes visited, scatter calls and path lengths,
+-- printed after the render, e.g. `xmake f --counters=y`
+option("counters")
+  set_default(false)
+  set_showmenu(true)
+  set_description("Build with hot path counters")
+option_end()
+
+if has_config("native") then
+  add_cxflags("-march=native")
+  set_policy("build.optimization.lto", true)
+end
+if has_config("counters") then
+  add_defines("RAY_TRACING_COUNTERS")
+end
+
+-- Every target is built twice: with double as the real type, and with float
+-- (suffix -float) for throughput, e.g. `xmake build ray-tracing-demo-cpu-float`
+for _, precision in ipairs({"double", "float"}) do
+  local suffix = precision == "float" and "-float" or ""
+
+  -- Renderer library shared by the demo and the benchmark
+  target("ray-tracing" .. suffix)
+    set_kind("static")
+    add_includedirs("include", {public = true})
+    add_files("src/lib/*/*.cc")
+    add_packages("toml++", {public = true})
+    add_packages("zlib")
+    if precision == "float" then
+      add_defines("RAY_TRACING_FLOAT", {public = true})
+    end
+
+  target("ray-tracing-demo-cpu" .. suffix)
+    set_kind("binary")
+    add_deps("ray-tracing" .. suffix)
+    add_files("src/main.cc")
+    add_packages("toml++")
+    add_packages("argparse")
+    add_packages("zlib")
+
+  -- Reference scene benchmark printing rays per second as JSON, built with
+  -- `xmake build ray-tracing-benchmark` and run from the project directory
+  target("ray-tracing-benchmark" .. suffix)
+    set_kind("binary")
+    set_default(false)
+    add_deps("ray-tracing" .. suffix)
+    add_files("src/benchmark.cc")
+    add_packages("toml++")
+    add_packages("argparse")
+    add_packages("zlib")
+
+  -- Unit tests of the renderer library, run with `xmake test`
+  target("ray-tracing-tests" .. suffix)
+    set_kind("binary")
+    set_default(false)
+    add_deps("ray-tracing" .. suffix)
+    add_files("tests/*.cc")
+    add_packages("toml++")
+    add_packages("zlib")
+    add_tests("default")
+  target_end()
+end